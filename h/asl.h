@@ -13,9 +13,15 @@
 
 extern int insertBlocked (int *semAdd, pcb_PTR p);
 extern pcb_PTR removeBlocked (int *semAdd);
+extern int removeAllBlocked (int *semAdd, pcb_PTR *tp);
 extern pcb_PTR outBlocked (pcb_PTR p);
 extern pcb_PTR headBlocked (int *semAdd);
 extern void initASL ();
+extern int reserveSemd ();
+extern void unreserveSemds (int count);
+
+extern int semdInUse;
+extern int semdHighWater;
 
 /***************************************************************/
 
@@ -25,11 +25,42 @@
 #define EOS '\0'
 
 #define NULL ((void *)0xFFFFFFFF)
-#define MAXPROC 20        /* Maximum number of concurrent processes */
+#define MAXPROC 20        /* Statically allocated pcbs; more are carved from slabs on demand */
+#define MAXSEMD 40        /* Statically allocated semaphore descriptors; more are carved from slabs on demand */
 #define MAXINT 0x7FFFFFFF /* Maximum positive integer for 32-bit systems */
 #define CLOCKINTERVAL 100000UL
 #define SECOND 1000000
 
+/* Scheduler constants */
+#define QUANTUM 5000      /* Default PLT time slice in microseconds */
+#define MINQUANTUM 1000   /* Shortest time slice handed out by the adaptive quantum */
+#define MAXQUANTUM 20000  /* Longest time slice handed out by the adaptive quantum */
+#define SHORTBURST MINQUANTUM /* Processes whose average burst is below this are latency-sensitive */
+#define DEFAULTSHARE 100  /* CPU share (stride tickets) of a process nobody set a share for */
+#define MAXSHARE 1000     /* Largest CPU share a process can hold */
+#define STRIDE1 65536     /* Stride of a process holding a single ticket */
+#define RTMAXLOAD 900     /* Per-mille of the CPU that real-time processes may reserve */
+#define NUMPRIOLEVELS 4   /* Number of MLFQ ready queues (level 0 is the highest priority) */
+#define AGINGPERIOD 1000000 /* Microseconds between two aging passes over the ready queues */
+#define PIDSLOTBITS 8     /* Low pid bits holding the handle table slot */
+#define MAXPIDS (1 << PIDSLOTBITS) /* Handle table slots: processes that can hold a pid at once */
+#define PIDGENMASK 0x7FFFFF /* Generation bits above the slot (pids stay positive) */
+#define MAXBATCH 32       /* Most entries a MULTICALL batch may hold */
+#define MAXMUTEX 32       /* Semaphores that can be used as priority inheritance mutexes */
+#define ACCTUSER 0        /* CPU time accounting: running its own code (user mode or the support level) */
+#define ACCTKERNEL 1      /* CPU time accounting: in the nucleus serving its exceptions */
+#define ACCTBLOCKED 2     /* CPU time accounting: blocked, or waiting for its next real-time release */
+#define ACCTKINDS 3       /* Number of CPU time accumulators of a process */
+#define LATBUCKETS 20     /* Run-queue latency histogram buckets: bucket i counts waits of 2^i to 2^(i+1)-1 microseconds (bucket 0 also 0), the last one everything longer */
+
+/* Multiprocessor constants */
+#define NCPU 1            /* Processors driven by the nucleus (must match the machine config, at most 16) */
+#define IDLEPOLL 1000     /* PLT wake-up interval of an idle CPU looking for work to steal (SMP only) */
+#define NUCLEUSSTACK 0x20001000 /* Nucleus stack of CPU 0 */
+
+/* Nucleus stack of secondary CPU cpu, one frame each, right below the U-proc support stacks */
+#define CPUSTACK(cpu) (RAMTOP - ((2 * UPROCMAX) + (cpu)) * PAGESIZE)
+
 /* Status Register Bit Masks */
 #define IEPBITON 0x4         /* Previous Interrupt Enable (bit 2) */
 #define KUPBITON 0x8         /* Previous Kernel/User Mode (bit 3) */
@@ -96,6 +127,9 @@
 #define BIOSDATAPAGE 0x0FFFF000
 #define PASSUPVECTOR 0x0FFFF900
 
+/* Exception state saved by the BIOS for processor cpu (CPU 0 uses the start of the BIOS Data Page) */
+#define EXCSTATE(cpu) ((state_t *)(BIOSDATAPAGE + ((cpu) * sizeof(state_t))))
+
 /* Exceptions related constants */
 #define PGFAULTEXCEPT 0
 #define GENERALEXCEPT 1
@@ -103,11 +137,21 @@
 /* operations */
 #define MIN(A, B) ((A) < (B) ? A : B)
 #define MAX(A, B) ((A) < (B) ? B : A)
-#define ALIGNED(A) (((unsigned)A & 0x3) == 0)
+
+/* MLFQ level a process earned on its own, and the level it inherited
+   through the mutexes it holds (NUMPRIOLEVELS if it is not boosted) */
+#define OWNPRIO(p) ((p)->p_basePrio >= 0 ? (p)->p_basePrio : (p)->p_prio)
+#define INHERITEDPRIO(p) ((p)->p_basePrio >= 0 ? (p)->p_prio : NUMPRIOLEVELS)
+#define ALIGNED(A) (((unsigned long)(A) & 0x3) == 0)
 
 /* Macro to load the Interval Timer */
 #define LDIT(T) ((*((cpu_t *)INTERVALTMR)) = (T) * (*((cpu_t *)TIMESCALEADDR)))
 
+/* Macro to park the Interval Timer when no timed event is pending; a stray
+   interrupt after MAXINT ticks just parks it again. MAXINT is written raw,
+   not scaled by TIMESCALEADDR like LDIT, since the product would overflow */
+#define PARKIT() ((*((cpu_t *)INTERVALTMR)) = MAXINT)
+
 /* Macro to read the TOD clock */
 #define STCK(T) ((T) = ((*((cpu_t *)TODLOADDR)) / (*((cpu_t *)TIMESCALEADDR))))
 
@@ -130,6 +174,32 @@
 #define FLASH_GET 16
 #define FLASH_PUT 17
 #define DELAY 18
+#define SETSHARE 21
+#define SETPERIODIC 22
+#define WAITPERIOD 23
+#define GETLATENCY 24
+#define GETCPUTIMES 25
+
+/* Nucleus SYSCALL extensions (kernel mode only) */
+#define SETPROCSHARE 32
+#define SETREALTIME 33
+#define WAITRELEASE 34
+#define GETSCHEDSTATS 35
+#define MUTEXP 36
+#define MUTEXV 37
+#define VERHOGENYIELD 38
+#define VERHOGENALL 39
+#define TERMINATEPID 40
+#define GETPID 41
+#define GETCPUSTATS 42
+#define MULTICALL 43
+#define PASSERENTIMED 44
+#define LASTNUCLEUSSYS PASSERENTIMED
+
+#define SEMTIMEOUT -1 /* PASSERENTIMED result: the timeout expired before a V */
+
+/* SYSCALLs served by the nucleus; every other number is passed up */
+#define NUCLEUSSYSCALL(n) (((n) >= CREATEPROCESS && (n) <= GETSUPPORTPTR) || ((n) >= SETPROCSHARE && (n) <= LASTNUCLEUSSYS))
 
 #define PAGE_TABLE_SIZE 32
 #define SWAP_POOL_SIZE 16
@@ -141,6 +211,10 @@
 
 #define FRAMEPOOL RAMSTART + (SWAP_POOL_START_FRAME * PAGESIZE)
 
+/* Free RAM frames the nucleus carves slabs from: above the swap pool, below the lowest handler stack */
+#define SLABSTART (FRAMEPOOL + (SWAP_POOL_SIZE * PAGESIZE))
+#define SLABEND (RAMTOP - ((2 * UPROCMAX) + NCPU) * PAGESIZE)
+
 #define UPROCMAX 8
 #define SUPPORT_STRUCT_POOL_SIZE UPROCMAX
 #define VPNSHIFT 12 /* Shift to get VPN from EntryLo */
@@ -16,6 +16,7 @@
 #include "../h/types.h"
 
 extern int ADLsem;
+extern int ADLworkSem;
 
 extern void supDelay(int secCnt);
 extern void delayDaemon();
@@ -11,23 +11,36 @@
  *
  */
 
+#include "../h/types.h"
+
 extern void exceptionHandler();
 
 extern void syscallHandler();
 extern int sysCreateProcess();
 extern void sysTerminate();
+extern int sysTerminatePid();
 extern void sysPasseren();
-extern void sysVerhogen();
+extern void sysPasserenTimed();
+extern pcb_PTR sysVerhogen();
+extern void sysVerhogenYield();
+extern int sysVerhogenAll();
+extern int verhogenAll(int *semAddr);
 extern void sysWaitIO();
 extern void sysGetCPUTime();
 extern void sysWaitClock();
 extern void *sysGetSupportPTR();
+extern void sysSetShare();
+extern void sysWaitRelease();
+extern void sysMultiCall();
 
 extern void programTrapHandler();
 extern void TLBExceptionHandler();
 extern void updateCPUTime();
+extern void chargeTime(pcb_PTR p, int kind);
+extern void sysGetSchedStats(latstats_t *stats);
+extern void sysGetCPUStats(cpustats_t *stats);
 extern void passUpOrDie(int exceptType);
-extern void memcopy();
+extern void saveState(state_t *savedState);
 
 /******************************************************************/
 
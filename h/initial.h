@@ -19,11 +19,16 @@
 /* Global Variables */
 extern int processCount;                  
 extern int softBlockCount;                
-extern pcb_PTR readyQueue;               
-extern pcb_PTR currentProcess;
+extern pcb_PTR readyQueues[NCPU][NUMPRIOLEVELS];
+extern int readyCount[NCPU];
+extern int shortReadyCount[NCPU];
+extern pcb_PTR currentProcs[NCPU];
 extern int deviceSemaphores[NUM_DEVICES + 1];
 extern int masterSemaphore;
 
+/* Process running on the executing CPU */
+#define currentProcess (currentProcs[getPRID()])
+
 /* Function Prototypes */
 extern void main();
 extern void createProcess();
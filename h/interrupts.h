@@ -7,17 +7,29 @@
  *  module.
  *
  *  Implements an interrupt handler that determines the highest priority
- *  pending interrupt and dispatches it to the appropriate handler.
+ *  pending interrupt and dispatches it to the appropriate handler,
+ *  programs the interval timer on demand and keeps the deadlines
+ *  of timed P operations.
  *
  */
 
+#include "../h/types.h"
+
+extern void initIntervalTimer();
+extern cpu_t nextClockTick();
+extern void armIntervalTimer(cpu_t when);
+extern void addTimeout(pcb_PTR p, cpu_t deadline);
+extern void cancelTimeout(pcb_PTR p);
 extern void interruptHandler();
+extern void chargeInterrupt();
 extern void handlePLTInterrupt();
 extern void handleIntervalTimerInterrupt();
 extern void handleDeviceInterrupt(int intLine);
 extern int getHighestPriorityInterrupt();
 extern int getHighestPriorityDevice(int intLine);
 
+extern cpu_t interruptTime[NCPU];
+
 /*******************************************************************/
 
 #endif
@@ -0,0 +1,21 @@
+#ifndef KLIB
+#define KLIB
+
+/************************* KLIB.H *****************************
+ *
+ *  The externals declaration file for the kernel block
+ *  memory library.
+ *
+ *  Implements word-at-a-time block copy and zero routines
+ *  used by the nucleus and the support level.
+ *
+ */
+
+#include "../h/types.h"
+
+extern void memcopy(void *dest, const void *src, unsigned int n);
+extern void memzero(void *dest, unsigned int n);
+
+/***************************************************************/
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef MUTEX
+#define MUTEX
+
+/************************* MUTEX.H *****************************
+ *
+ *  The externals declaration file for the mutex module.
+ *
+ *  Implements owner-tracking mutexes whose owner inherits the
+ *  priority of the processes waiting for them, and records how
+ *  long each mutex is held.
+ *
+ */
+
+#include "../h/types.h"
+
+extern void initMutexes();
+extern int sysMutexP(state_t *savedState, int *semAddr);
+extern int sysMutexV(int *semAddr);
+extern void releaseMutexes(pcb_PTR p);
+extern void dropWaiter(int *semAddr);
+extern void getMutexStats(latstats_t *stats);
+
+/***************************************************************/
+
+#endif
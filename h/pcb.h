@@ -12,6 +12,7 @@
 #include "../h/types.h"
 
 extern void freePcb (pcb_PTR p);
+extern void freePcbs (pcb_PTR chain);
 extern pcb_PTR allocPcb ();
 extern void initPcbs ();
 
@@ -21,6 +22,7 @@ extern void insertProcQ (pcb_PTR *tp, pcb_PTR p);
 extern pcb_PTR removeProcQ (pcb_PTR *tp);
 extern pcb_PTR outProcQ (pcb_PTR *tp, pcb_PTR p);
 extern pcb_PTR headProcQ (pcb_PTR tp);
+extern void mergeProcQ (pcb_PTR *tp, pcb_PTR *src);
 
 extern int emptyChild (pcb_PTR p);
 extern void insertChild (pcb_PTR prnt, pcb_PTR p);
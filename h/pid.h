@@ -0,0 +1,23 @@
+#ifndef PID
+#define PID
+
+/************************* PID.H *****************************
+ *
+ *  The externals declaration file for the process handle
+ *  table.
+ *
+ *  Implements generation-tagged process ids with constant
+ *  time issue, lookup and release.
+ *
+ */
+
+#include "../h/types.h"
+
+extern void initPids();
+extern int allocPid(pcb_PTR p);
+extern void freePid(pcb_PTR p);
+extern pcb_PTR pidLookup(int pid);
+
+/***************************************************************/
+
+#endif
@@ -5,11 +5,35 @@
  *
  *  The externals declaration file for the Scheduler Module.
  *
- *  Implements a preemptive round-robin scheduling algorithm.
+ *  Implements an earliest-deadline-first real-time class on top of
+ *  a preemptive multi-level feedback queue scheduling algorithm.
  *  Handles process dispatching and deadlock detection.
  */
 
+#include "../h/types.h"
+
 extern void scheduler();
+extern void makeReady(pcb_PTR p);
+extern pcb_PTR outReady(pcb_PTR p);
+extern int outranked(pcb_PTR p);
+extern void setPrio(pcb_PTR p, int own, int inherited);
+extern void demote(pcb_PTR p);
+extern void promote(pcb_PTR p);
+extern void endBurst(pcb_PTR p);
+extern int setShare(pcb_PTR p, int tickets);
+extern void resumeIfAlone(pcb_PTR p);
+extern void handOff(pcb_PTR p);
+extern void getLatency(pcb_PTR p, latstats_t *stats);
+extern void releaseJobs();
+extern cpu_t nextRelease();
+extern int setRealtime(pcb_PTR p, cpu_t period, cpu_t budget);
+extern int completeJob(pcb_PTR p);
+extern void dropRealtime(pcb_PTR p);
+
+extern int fastPathHits;
+extern int latencyHist[LATBUCKETS];
+extern int rtJobs;
+extern int rtMisses;
 
 /******************************************************************/
 
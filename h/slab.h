@@ -0,0 +1,27 @@
+#ifndef SLAB
+#define SLAB
+
+/************************* SLAB.H *****************************
+ *
+ *  The externals declaration file for the slab allocator.
+ *
+ *  Hands out pcbs, their save areas and semaphore descriptors
+ *  beyond the static tables from page-sized slabs carved out of
+ *  free RAM frames.
+ *
+ */
+
+#include "../h/types.h"
+
+extern slabcache_t pcbSlabs;
+extern slabcache_t semdSlabs;
+extern slabcache_t stateSlabs;
+
+extern void initSlabs();
+extern void *slabAlloc(slabcache_t *cache);
+extern void slabFree(void *obj);
+extern int slabOwns(slabcache_t *cache, void *obj);
+
+/***************************************************************/
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SMP
+#define SMP
+
+/************************* SMP.H *****************************
+ *
+ *  The externals declaration file for the multiprocessor
+ *  support module.
+ *
+ *  Implements the CAS-based nucleus lock, secondary CPU boot
+ *  and the TLB shootdown used by the pager.
+ *
+ */
+
+#include "../h/types.h"
+
+extern unsigned int globalLock;
+extern int tlbEpoch;
+
+extern void acquireLock(unsigned int *lock);
+extern void releaseLock(unsigned int *lock);
+extern void bootSecondaryCPUs();
+extern void cpuStart();
+extern int busyCPUs();
+extern void syncTLB();
+extern void tlbShootdown();
+
+/***************************************************************/
+
+#endif
@@ -19,6 +19,9 @@ extern void supportSyscallHandler();
 extern void supportProgTrapHandler();
 extern void supTerminate();
 extern void supGetTOD();
+extern void supSetShare();
+extern void supGetLatency();
+extern void supGetCPUTimes();
 extern void supWriteToPrinter();
 extern void supWriteToTerminal();
 extern void supReadTerminal();
@@ -124,12 +124,27 @@ typedef struct support_t
 	int sup_privateSem;								 /* Semaphore used to delay this U-proc during SYS18 */
 } support_t;
 
-/* Process Control Block Type */
+/* Process Control Block Type. The fields touched by queue operations and
+   on every dispatch come first, packed together; the processor state lives
+   in a separate save area written only on context switches. */
 typedef struct pcb_t
 {
 	/* Process queue fields */
-	struct pcb_t *p_next; /* Pointer to next entry */
-	struct pcb_t *p_prev; /* Pointer to prev entry */
+	struct pcb_t *p_next;	/* Pointer to next entry */
+	struct pcb_t *p_prev;	/* Pointer to prev entry */
+	struct pcb_t **p_queue; /* Tail pointer of the queue holding the pcb (NULL if none) */
+
+	/* Hot process status information */
+	int *p_semAdd;				/* Pointer to semaphore on which process is blocked */
+	cpu_t p_time;				/* CPU time used by process */
+	unsigned int p_startTOD;	/* Start of the time not accounted for yet (set at dispatch) */
+	int p_prio;					/* MLFQ level it runs at (0 = highest priority) */
+	int p_cpu;					/* CPU whose ready queues hold the process (-1 if not placed yet) */
+	unsigned int p_pass;		/* Virtual time consumed; lowest pass runs first within a level */
+	support_t *p_supportStruct; /* Pointer to support struct */
+	int p_pid;					/* Process id (-1 if the process has none) */
+	int p_dying;				/* TRUE once terminated while running on another CPU */
+	state_t *p_s;				/* Processor state save area (bound to the pcb for good) */
 
 	/* Process tree fields */
 	struct pcb_t *p_prnt;	   /* Pointer to parent */
@@ -137,21 +152,108 @@ typedef struct pcb_t
 	struct pcb_t *p_sib_right; /* Pointer to right sibling */
 	struct pcb_t *p_sib_left;  /* Pointer to left sibling */
 
-	/* Process status information */
-	state_t p_s;			 /* Processor state */
-	cpu_t p_time;			 /* CPU time used by process */
-	unsigned int p_startTOD; /* Time slice start (needed for SYS6) */
-	int *p_semAdd;			 /* Pointer to semaphore on which process is blocked */
+	/* Scheduling information */
+	int p_basePrio;			/* MLFQ level earned on its own while boosted by priority inheritance (-1 if not boosted) */
+	cpu_t p_burst;			/* Running average of the CPU bursts of the process */
+	cpu_t p_burstStart;		/* Time of day the current CPU burst started */
+	int p_tickets;			/* CPU share of the process (stride scheduling) */
+	unsigned int p_stride;	/* STRIDE1 / p_tickets */
 
-	/* Support layer information */
-	support_t *p_supportStruct; /* Pointer to support struct */
+	/* Real-time (EDF) information */
+	cpu_t p_period;	  /* Release period (0 for best-effort processes) */
+	cpu_t p_budget;	  /* CPU time reserved per period */
+	cpu_t p_rtUsed;	  /* CPU time used by the current job */
+	cpu_t p_release;  /* Release time of the current job */
+	cpu_t p_deadline; /* Absolute deadline of the current job */
+	int p_rtJobs;	  /* Jobs completed */
+	int p_rtMisses;	  /* Jobs completed after their deadline */
+
+	/* Run-queue latency information */
+	cpu_t p_readyTOD;		   /* Time of day the process last became ready */
+	int p_latHist[LATBUCKETS]; /* Log2 histogram of its waits in the ready queues */
+
+	/* CPU time accounting */
+	cpu_t p_acct[ACCTKINDS]; /* Time spent in each ACCT* state */
+	cpu_t p_blockTOD;		 /* Time of day the process blocked (0 if not blocked) */
+
+	/* Timed P information */
+	cpu_t p_timeout;		   /* Deadline of its timed P (0 if none pending) */
+	struct pcb_t *p_tmNext;	   /* Next pending timeout (later or equal deadline) */
+	struct pcb_t *p_tmPrev;	   /* Previous pending timeout */
 
 } pcb_t, *pcb_PTR;
 
+/* Process handle table entry */
+typedef struct pidEntry_t
+{
+	struct pcb_t *h_pcb; /* Process holding the slot, NULL if free */
+	int h_gen;			 /* Generation of the slot, bumped on every reuse */
+	int h_nextFree;		 /* Next free slot (-1 ends the list) */
+} pidEntry_t;
+
+/* Run-queue latency histograms, ASL descriptor usage and mutex hold
+   times returned by GETLATENCY */
+typedef struct latstats_t
+{
+	int ls_proc[LATBUCKETS];   /* Waits of the calling process */
+	int ls_global[LATBUCKETS]; /* Waits of every process since boot */
+	int ls_semdInUse;		   /* Semaphore descriptors on the ASL */
+	int ls_semdHighWater;	   /* Most descriptors the ASL ever held */
+	int ls_mutexAcquires;	   /* Times any mutex was taken since boot */
+	cpu_t ls_mutexHoldTotal;   /* Total time mutexes were held (releases so far) */
+	cpu_t ls_mutexHoldMax;	   /* Longest time any mutex was held */
+} latstats_t;
+
+/* One entry of a MULTICALL batch */
+typedef struct syscall_t
+{
+	int sc_num;	   /* SYSCALL number */
+	int sc_a1;	   /* Arguments, as they would be passed in a1-a3 */
+	int sc_a2;
+	int sc_a3;
+	int sc_result; /* Filled by the nucleus with what the SYSCALL returns in v0 */
+} syscall_t;
+
+/* CPU time breakdown returned by GETCPUTIMES */
+typedef struct cpustats_t
+{
+	cpu_t cs_time[ACCTKINDS]; /* Time of the calling process, indexed by ACCT* */
+	cpu_t cs_interrupt;		  /* Time every CPU spent serving interrupts since boot */
+} cpustats_t;
+
+/* Owner-tracking mutex (a binary semaphore locked through MUTEXP) */
+typedef struct mutex_t
+{
+	int *m_semAdd;		   /* Semaphore of the mutex (NULL for a free entry) */
+	struct pcb_t *m_owner; /* Process holding the mutex, NULL if free */
+	cpu_t m_acquired;	   /* Time of day the owner took the mutex */
+	int m_acquires;		   /* Times the mutex was taken */
+	cpu_t m_holdTotal;	   /* Total time the mutex was held */
+	cpu_t m_holdMax;	   /* Longest time the mutex was held */
+} mutex_t;
+
+/* Slab: one RAM frame holding same-sized objects, headed by this descriptor */
+typedef struct slab_t
+{
+	struct slab_t *sl_next;		  /* Next slab of the same cache */
+	struct slabcache_t *sl_cache; /* Cache the slab belongs to */
+	void *sl_free;				  /* First free object (each free object links the next) */
+	int sl_inUse;				  /* Objects handed out */
+} slab_t;
+
+/* Slab cache: the slabs holding one kind of object */
+typedef struct slabcache_t
+{
+	int sc_objSize;	   /* Size of each object in bytes */
+	slab_t *sc_slabs;  /* Slabs of the cache */
+	int sc_slabCount;  /* Number of slabs */
+} slabcache_t;
+
 /* semaphore descriptor type */
 typedef struct semd_t
 {
-	struct semd_t *s_next; /* Pointer to next semaphore in ASL */
+	struct semd_t *s_next; /* Pointer to next semaphore in the ASL bucket (or free list) */
+	struct semd_t *s_prev; /* Pointer to previous semaphore in the ASL bucket */
 	int *s_semAdd;		   /* Pointer to the semaphore */
 	pcb_t *s_procQ;		   /* Tail pointer to a process queue */
 } semd_t;
@@ -4,89 +4,171 @@
  * The ASL is used to track active semaphores and their associated process queues.
  *
  * Data Structure Overview:
- * - semd_t semdTable[MAXSEMD + 2]: A static array of semaphore descriptors.
- *   The first and last elements serve as dummy head and tail nodes for efficient list traversal.
- * - semd_h: Pointer to the head of the ASL, initialized with the dummy head node.
+ * - semd_t semdTable[MAXSEMD]: A static array of semaphore descriptors.
+ * - semdHash[ASLBUCKETS]: The ASL itself, a hash table keyed on the semaphore
+ *   address. Each bucket is a NULL-terminated doubly linked list of the active
+ *   descriptors whose address hashes to it.
  * - semdFree_h: Pointer to the head of the free semaphore descriptor list.
+ * - deviceSemds[NUM_DEVICES + 1]: One descriptor per device semaphore (and the
+ *   pseudo-clock), bound to it for good at initialization.
  *
  * Implementation Summary:
- * - The ASL is maintained as a sorted singly linked list using semaphore addresses (s_semAdd) for ordering.
- * - Semaphore descriptors are allocated from semdFree_h and returned to it when no longer needed.
+ * - Semaphores are word aligned and mostly laid out in arrays (device semaphores,
+ *   support level mutexes), so dropping the two low address bits spreads them over
+ *   consecutive buckets; with ASLBUCKETS >= MAXSEMD a bucket rarely holds more than
+ *   one descriptor, making lookup, insertion and removal constant time in practice.
+ * - Descriptors are unlinked in constant time through s_prev, without searching
+ *   for their predecessor.
+ * - Device and pseudo-clock semaphores never enter the hash table nor use semdTable:
+ *   their descriptor is found by indexing deviceSemds with the device number, so a
+ *   burst of outstanding I/O can neither slow down lookups nor run out of descriptors.
+ * - Semaphore descriptors are allocated from semdFree_h and returned to it when no longer needed;
+ *   once semdTable is used up, they come from the slab allocator (semdSlabs) instead. semdTable
+ *   is sized on its own (MAXSEMD), independently of the pcb table.
+ * - Every process holds a descriptor reservation (reserveSemd()) from its creation to its
+ *   termination, and semdFree_h always keeps enough spares to cover the reservations of the
+ *   processes not blocked yet. A process blocks on one semaphore at a time, so insertBlocked()
+ *   never runs out of descriptors for a process holding a reservation.
+ * - semdInUse counts the descriptors on the ASL and semdHighWater the most it ever held, so the
+ *   static table can be sized against real workloads; both are reported by GETLATENCY.
  * - Functions are provided for inserting, removing, and querying process control blocks (pcbs) associated with semaphores.
 ***************************************************************/
 
 #include "../h/asl.h"
 #include "../h/pcb.h"
 #include "../h/const.h"
+#include "../h/initial.h"
+#include "../h/slab.h"
 
-#define MAXSEMD MAXPROC /* MAXSEMD is set to MAXPROC */
+#define ASLBUCKETS 64   /* Hash buckets of the ASL (a power of 2, at least MAXSEMD) */
 
-/* Static array of semaphore descriptors (+2 for dummy head/tail) */
-static semd_t semdTable[MAXSEMD + 2];
+/* Descriptor whose process queue has the tail pointer at address q */
+#define QUEUESEMD(q) ((semd_t *)((char *)(q) - (char *)&(((semd_t *)0)->s_procQ)))
 
-/* Head of Active Semaphore List (ASL) */
-static semd_t *semd_h;
+/* TRUE if semAdd is one of the device semaphores (or the pseudo-clock) */
+#define DEVICESEM(semAdd) ((semAdd) >= &deviceSemaphores[0] && (semAdd) <= &deviceSemaphores[NUM_DEVICES])
+
+/* TRUE if the descriptor s belongs to semdTable rather than to a slab */
+#define STATICSEMD(s) ((s) >= &semdTable[0] && (s) < &semdTable[MAXSEMD])
+
+/* Bucket of the ASL for the semaphore at semAdd (unsigned long holds a
+   pointer on uMPS3 and on 64-bit hosts alike) */
+#define SEMHASH(semAdd) ((((unsigned long)(semAdd)) >> 2) & (ASLBUCKETS - 1))
+
+/* Static array of semaphore descriptors */
+static semd_t semdTable[MAXSEMD];
+
+/* Active Semaphore List (ASL), hashed on the semaphore address */
+static semd_t *semdHash[ASLBUCKETS];
 
 /* Head of Free Semaphore List */
 static semd_t *semdFree_h;
 
+static int semdSpare;    /* Descriptors on semdFree_h */
+static int semdReserved; /* Descriptor reservations held by live processes */
+
+int semdInUse;     /* Descriptors on the ASL (device semaphores excluded) */
+int semdHighWater; /* Largest value semdInUse ever reached */
+
+/* Descriptors of the device semaphores, indexed by device number */
+static semd_t deviceSemds[NUM_DEVICES + 1];
+
 /**
- * Initializes semdFree_h with semdTable[MAXSEMD] and sets up semd_h
- * with dummy head and tail nodes for efficient ASL traversal.
+ * Empties every bucket of the ASL, puts all of semdTable on semdFree_h and
+ * binds each device semaphore to its descriptor in deviceSemds.
  * Called once during system initialization.
  */
 void initASL()
 {
-    /* Initialize dummy head and tail nodes */
-    semd_h = &semdTable[0];      /* Head dummy node */
-    semd_h->s_semAdd = (int *)0; /* Set head sentinel value */
-
-    semd_t *tail = &semdTable[MAXSEMD + 1]; /* Tail dummy node */
-    tail->s_semAdd = (int *)MAXINT;         /* Set tail sentinel value */
+    int i;
+    for (i = 0; i < ASLBUCKETS; i++)
+    {
+        semdHash[i] = NULL;
+    }
 
-    semd_h->s_next = tail; /* Link head to tail */
-    tail->s_next = NULL;   /* Tail points to NULL */
+    for (i = 0; i < NUM_DEVICES + 1; i++)
+    {
+        deviceSemds[i].s_semAdd = &deviceSemaphores[i];
+        deviceSemds[i].s_procQ = mkEmptyProcQ();
+        deviceSemds[i].s_next = NULL;
+        deviceSemds[i].s_prev = NULL;
+    }
 
     /* Initialize the Free List */
-    semdFree_h = &semdTable[1]; /* First free semaphore */
-
-    int i;
-    for (i = 1; i < MAXSEMD; i++)
+    semdFree_h = NULL;
+    for (i = MAXSEMD - 1; i >= 0; i--)
     {
-        semdTable[i].s_next = &semdTable[i + 1]; /* Link free list elements */
+        semdTable[i].s_next = semdFree_h; /* Link free list elements */
+        semdFree_h = &semdTable[i];
     }
 
-    semdTable[MAXSEMD].s_next = NULL; /* Last free element points to NULL */
+    semdSpare = MAXSEMD;
+    semdReserved = 0;
+    semdInUse = 0;
+    semdHighWater = 0;
 }
 
 /**
- * Traverses the ASL to find a semaphore descriptor matching semAdd.
+ * Looks up the semaphore descriptor matching semAdd: directly by device
+ * number for a device semaphore, in its hash bucket otherwise.
  * Returns a pointer to the descriptor, or NULL if not found.
  */
 static semd_t *findSemd(int *semAdd)
 {
-    semd_t *current = semd_h->s_next; /* Start from first real node */
+    if (DEVICESEM(semAdd))
+        return &deviceSemds[semAdd - deviceSemaphores];
+
+    semd_t *current = semdHash[SEMHASH(semAdd)];
 
-    while (current != NULL && current->s_semAdd < semAdd)
+    while (current != NULL && current->s_semAdd != semAdd)
     {
         current = current->s_next;
     }
 
-    /* If found, return the descriptor; otherwise, return NULL */
-    if (current != NULL && current->s_semAdd == semAdd)
+    return current;
+}
+
+/**
+ * Unlinks a descriptor whose process queue became empty from its
+ * hash bucket and returns it to semdFree_h. Device semaphore
+ * descriptors stay bound to their semaphore.
+ */
+static void freeSemd(semd_t *semd)
+{
+    if (semd >= &deviceSemds[0] && semd <= &deviceSemds[NUM_DEVICES])
+        return;
+
+    if (semd->s_prev != NULL)
+        semd->s_prev->s_next = semd->s_next;
+    else
+        semdHash[SEMHASH(semd->s_semAdd)] = semd->s_next;
+
+    if (semd->s_next != NULL)
+        semd->s_next->s_prev = semd->s_prev;
+
+    semdInUse--;
+
+    /* Return the semaphore descriptor to the free list, or to its slab
+       unless it is needed as a spare */
+    if (STATICSEMD(semd) || semdSpare < semdReserved - semdInUse)
     {
-        return current;
+        semd->s_next = semdFree_h;
+        semdFree_h = semd;
+        semdSpare++;
+    }
+    else
+    {
+        slabFree(semd);
     }
-
-    return NULL;
 }
 
 /**
  * Inserts the pcb p at the tail of the process queue associated with
  * the semaphore at semAdd. If the semaphore is inactive, allocates a
- * new descriptor from semdFree_h and inserts it into the ASL in sorted order.
- * Returns TRUE if a new descriptor is needed but semdFree_h is empty,
- * otherwise returns FALSE.
+ * new descriptor from semdFree_h and links it at the head of its hash bucket.
+ * Returns TRUE if a new descriptor is needed but neither semdFree_h nor
+ * the slabs can provide one (never the case for a process holding a
+ * reservation), otherwise returns FALSE.
  */
 int insertBlocked(int *semAdd, pcb_t *p)
 {
@@ -97,25 +179,34 @@ int insertBlocked(int *semAdd, pcb_t *p)
 
     if (semd == NULL)
     {
-        /* Allocate new semd_t from the free list */
-        if (semdFree_h == NULL)
-            return TRUE; /* No free descriptors available */
-
-        semd = semdFree_h;               /* Take first free descriptor */
-        semdFree_h = semdFree_h->s_next; /* Update free list */
+        /* Allocate new semd_t from the free list, then from the slabs */
+        if (semdFree_h != NULL)
+        {
+            semd = semdFree_h;               /* Take first free descriptor */
+            semdFree_h = semdFree_h->s_next; /* Update free list */
+            semdSpare--;
+        }
+        else
+        {
+            semd = (semd_t *)slabAlloc(&semdSlabs);
+            if (semd == NULL)
+                return TRUE; /* No free descriptors available */
+        }
 
         /* Initialize new semaphore descriptor */
         semd->s_semAdd = semAdd;
         semd->s_procQ = mkEmptyProcQ();
 
-        /* Insert into ASL in sorted order */
-        semd_t *prev = semd_h;
-        while (prev->s_next != NULL && prev->s_next->s_semAdd < semAdd)
-        {
-            prev = prev->s_next;
-        }
-        semd->s_next = prev->s_next;
-        prev->s_next = semd;
+        /* Insert at the head of its bucket */
+        semd_t **bucket = &semdHash[SEMHASH(semAdd)];
+        semd->s_prev = NULL;
+        semd->s_next = *bucket;
+        if (*bucket != NULL)
+            (*bucket)->s_prev = semd;
+        *bucket = semd;
+
+        if (++semdInUse > semdHighWater)
+            semdHighWater = semdInUse;
     }
 
     /* Insert process into the process queue */
@@ -151,41 +242,60 @@ pcb_t *removeBlocked(int *semAdd)
     /* If the process queue is now empty, remove the semaphore descriptor from ASL */
     if (emptyProcQ(semd->s_procQ))
     {
-        /* Find and remove the semaphore descriptor from ASL */
-        semd_t *prev = semd_h;
-        while (prev->s_next != NULL && prev->s_next != semd)
-        {
-            prev = prev->s_next;
-        }
-        if (prev->s_next == semd)
-        {
-            prev->s_next = semd->s_next; /* Unlink semd from ASL */
-        }
-
-        /* Return the semaphore descriptor to the free list */
-        semd->s_next = semdFree_h;
-        semdFree_h = semd;
+        freeSemd(semd);
     }
 
     return removedPcb;
 }
 
+/**
+ * Moves every pcb blocked on the semaphore at semAdd, in order, to the
+ * tail of the queue *tp and clears their semaphore reference. The whole
+ * process queue is detached with a single lookup and the descriptor is
+ * returned to semdFree_h. Returns the number of pcbs moved.
+ */
+int removeAllBlocked(int *semAdd, pcb_t **tp)
+{
+    semd_t *semd = findSemd(semAdd); /* Find the semaphore descriptor */
+
+    if (semd == NULL || emptyProcQ(semd->s_procQ))
+        return 0; /* Nobody is blocked on this semaphore */
+
+    int count = 0;
+    pcb_t *p = headProcQ(semd->s_procQ);
+    do
+    {
+        p->p_semAdd = NULL;
+        count++;
+        p = p->p_next;
+    } while (p != headProcQ(semd->s_procQ));
+
+    mergeProcQ(tp, &(semd->s_procQ));
+    freeSemd(semd);
+
+    return count;
+}
+
 /**
  * Removes the pcb p from the process queue associated with
- * its semaphore (p->p_semAdd). If p is not found in the
- * queue, returns NULL. If the queue becomes empty, removes the
+ * its semaphore (p->p_semAdd). The descriptor is reached through the
+ * queue p records, without a lookup. If p is not blocked on its
+ * semaphore, returns NULL. If the queue becomes empty, removes the
  * semaphore descriptor from the ASL and returns it to semdFree_h.
  * Unlike removeBlocked(), this function does NOT reset p->p_semAdd to NULL.
  */
 pcb_t *outBlocked(pcb_t *p)
 {
-    if (p == NULL || p->p_semAdd == NULL)
+    if (p == NULL || p->p_semAdd == NULL || p->p_queue == NULL)
         return NULL; /* Invalid pcb or no semaphore */
 
-    semd_t *semd = findSemd(p->p_semAdd); /* Find the semaphore descriptor in ASL */
+    semd_t *semd = QUEUESEMD(p->p_queue); /* The descriptor owning p's queue */
 
-    if (semd == NULL)
-        return NULL; /* Semaphore not found (error condition) */
+    if (!(STATICSEMD(semd) ||
+          (semd >= &deviceSemds[0] && semd <= &deviceSemds[NUM_DEVICES]) ||
+          slabOwns(&semdSlabs, semd)) ||
+        semd->s_semAdd != p->p_semAdd)
+        return NULL; /* p is on some other queue (error condition) */
 
     /* Remove p from the process queue */
     pcb_t *removedPcb = outProcQ(&(semd->s_procQ), p);
@@ -195,19 +305,7 @@ pcb_t *outBlocked(pcb_t *p)
     /* If the process queue is now empty, remove the semaphore descriptor from ASL */
     if (emptyProcQ(semd->s_procQ))
     {
-        semd_t *prev = semd_h;
-        while (prev->s_next != NULL && prev->s_next != semd)
-        {
-            prev = prev->s_next;
-        }
-        if (prev->s_next == semd)
-        {
-            prev->s_next = semd->s_next; /* Unlink semd from ASL */
-        }
-
-        /* Return the semaphore descriptor to the free list */
-        semd->s_next = semdFree_h;
-        semdFree_h = semd;
+        freeSemd(semd);
     }
 
     return p;
@@ -228,3 +326,51 @@ pcb_t *headBlocked(int *semAdd)
 
     return headProcQ(semd->s_procQ); /* Return the first pcb (without removing it) */
 }
+
+/**
+ * Reserves a descriptor for a new process, so that it can always block on
+ * a semaphore: takes one from the slabs if the spares on semdFree_h do
+ * not cover every reservation. Returns TRUE on success, FALSE if the
+ * slabs are exhausted.
+ */
+int reserveSemd()
+{
+    if (semdSpare < semdReserved + 1 - semdInUse)
+    {
+        semd_t *semd = (semd_t *)slabAlloc(&semdSlabs);
+        if (semd == NULL)
+            return FALSE;
+
+        semd->s_next = semdFree_h;
+        semdFree_h = semd;
+        semdSpare++;
+    }
+
+    semdReserved++;
+    return TRUE;
+}
+
+/**
+ * Drops the reservations of count terminated processes, giving the spares
+ * taken from the slabs that are no longer needed back to them.
+ */
+void unreserveSemds(int count)
+{
+    semd_t **link = &semdFree_h;
+
+    semdReserved -= count;
+
+    while (semdSpare > semdReserved - semdInUse && *link != NULL)
+    {
+        semd_t *semd = *link;
+        if (STATICSEMD(semd))
+        {
+            link = &semd->s_next;
+            continue;
+        }
+
+        *link = semd->s_next;
+        semdSpare--;
+        slabFree(semd);
+    }
+}
@@ -7,7 +7,8 @@
  *  linked Active Delay List (ADL), which ends with a dummy tail node for simpler traversal and insertion.
  *  A kernel-mode Delay Daemon (ASID 0) runs in an infinite loop, waking every 100ms via SYS7 to check
  *  for expired delays. It wakes processes by performing a V on their private semaphores and recycles
- *  their descriptors back to the free list.
+ *  their descriptors back to the free list. While the ADL is empty the daemon sleeps on ADLworkSem
+ *  instead, so the interval timer stays parked when nobody is delayed.
  *
  *****************************************************************/
 
@@ -16,13 +17,17 @@
 #include "../h/const.h"
 #include "../h/types.h"
 #include "../h/pcb.h"
+#include "../h/asl.h"
 #include "../h/scheduler.h"
 #include "../h/exceptions.h"
 #include "../h/initial.h"
 #include "../h/initProc.h"
 #include "../h/vmSupport.h"
+#include "../h/pid.h"
 
 int ADLsem = 1;                        /* Semaphore for mutual exclusion over the ADL */
+int ADLworkSem = 0;                    /* The daemon sleeps here while the ADL is empty */
+int daemonIdle = FALSE;                /* TRUE while the daemon sleeps (or is about to) on ADLworkSem */
 delayd_t delaydTable[DELAY_LIST_SIZE]; /* Static pool of descriptors */
 delayd_t *delayd_h = NULL;             /* Head of ADL */
 delayd_t *delaydFree_h = NULL;         /* Head of Free List */
@@ -45,13 +50,13 @@ void supDelay(int secCnt)
     }
 
     /* Step 2: Get exclusive access to ADL */
-    SYSCALL(PASSEREN, (int)&ADLsem, 0, 0);
+    SYSCALL(MUTEXP, (int)&ADLsem, 0, 0);
 
     /* Step 3: Allocate a delay descriptor from the free list */
     delayd_t *node = delaydFree_h;
     if (node == NULL)
     {
-        SYSCALL(VERHOGEN, (int)&ADLsem, 0, 0); /* Release lock before terminating */
+        SYSCALL(MUTEXV, (int)&ADLsem, 0, 0); /* Release lock before terminating */
         supTerminate();                        /* Could not allocate descriptor */
     }
 
@@ -73,9 +78,23 @@ void supDelay(int secCnt)
     node->d_next = *ptr;
     *ptr = node;
 
-    /* Step 4: Atomically release ADL lock and block on private sem */
-    SYSCALL(VERHOGEN, (int)&ADLsem, 0, 0);                  /* Release mutual exclusion */
-    SYSCALL(PASSEREN, (int)&support->sup_privateSem, 0, 0); /* Block process */
+    /* Step 4: In one nucleus entry, wake the daemon if it stopped watching
+       the clock, release the ADL lock and block on the private sem */
+    syscall_t batch[3];
+    int n = 0;
+
+    if (daemonIdle)
+    {
+        daemonIdle = FALSE;
+        batch[n].sc_num = VERHOGEN;
+        batch[n++].sc_a1 = (int)&ADLworkSem;
+    }
+    batch[n].sc_num = MUTEXV; /* Release mutual exclusion */
+    batch[n++].sc_a1 = (int)&ADLsem;
+    batch[n].sc_num = PASSEREN; /* Block process */
+    batch[n++].sc_a1 = (int)&support->sup_privateSem;
+
+    SYSCALL(MULTICALL, (int)batch, n, 0);
 
     /* Step 5: Resume when delay expires */
     LDST(state);
@@ -83,7 +102,8 @@ void supDelay(int secCnt)
 
 /**
  * Main loop for the Delay Daemon process.
- * Waits for pseudo-clock tick events, then checks the ADL.
+ * Sleeps on ADLworkSem while the ADL is empty, otherwise waits for pseudo-clock tick events,
+ * then checks the ADL.
  * If any processes have expired delay times, it wakes them by performing a V on their private semaphores,
  * and returns their delay descriptor to the free list.
  */
@@ -91,11 +111,21 @@ void delayDaemon()
 {
     while (TRUE)
     {
+        /* Step 0: With nobody delayed, sleep until supDelay inserts a node */
+        SYSCALL(MUTEXP, (int)&ADLsem, 0, 0);
+        daemonIdle = (delayd_h->d_supStruct == NULL); /* Only the dummy tail left */
+        SYSCALL(MUTEXV, (int)&ADLsem, 0, 0);
+
+        if (daemonIdle)
+        {
+            SYSCALL(PASSEREN, (int)&ADLworkSem, 0, 0);
+        }
+
         /* Step 1: Wait for pseudo-clock tick (every 100ms) */
         SYSCALL(WAITCLOCK, 0, 0, 0); /* SYS7 */
 
         /* Step 2: Acquire mutual exclusion over the ADL */
-        SYSCALL(PASSEREN, (int)&ADLsem, 0, 0); /* SYS3 */
+        SYSCALL(MUTEXP, (int)&ADLsem, 0, 0); /* SYS36 */
 
         /* Step 3: Traverse and process expired delay nodes */
         cpu_t currTime;
@@ -104,11 +134,16 @@ void delayDaemon()
         delayd_t *prev = NULL;
         delayd_t *curr = delayd_h;
 
+        /* The wake-ups and the unlock go to the nucleus as one batch */
+        syscall_t batch[DELAY_LIST_SIZE];
+        int n = 0;
+
         /* Traverse the ADL and process expired delay nodes */
         while (curr != NULL && curr->d_supStruct != NULL && curr->d_wakeTime <= currTime)
         {
             /* Wake the U-proc by V on its private semaphore */
-            SYSCALL(VERHOGEN, (int)&(curr->d_supStruct->sup_privateSem), 0, 0); /* SYS4 */
+            batch[n].sc_num = VERHOGEN; /* SYS4 */
+            batch[n++].sc_a1 = (int)&(curr->d_supStruct->sup_privateSem);
 
             /* Remove from ADL and return to free list */
             delayd_t *expired = curr;
@@ -129,7 +164,10 @@ void delayDaemon()
         }
 
         /* Step 4: Release ADL lock */
-        SYSCALL(VERHOGEN, (int)&ADLsem, 0, 0); /* SYS4 */
+        batch[n].sc_num = MUTEXV; /* SYS37 */
+        batch[n++].sc_a1 = (int)&ADLsem;
+
+        SYSCALL(MULTICALL, (int)batch, n, 0); /* SYS43 */
     }
 }
 
@@ -172,13 +210,15 @@ void initADL()
     }
 
     /* Set kernel-mode state */
-    ddProc->p_s.s_pc = (memaddr)delayDaemon;
-    ddProc->p_s.s_t9 = (memaddr)delayDaemon;
-    ddProc->p_s.s_sp = RAMTOP - 2 * PAGESIZE; /* Stack right below test's stack */
-    ddProc->p_s.s_status = ALLOFF | IEPBITON | IM | TEBITON;
-    ddProc->p_s.s_entryHI = 0; /* Kernel ASID = 0 */
+    ddProc->p_s->s_pc = (memaddr)delayDaemon;
+    ddProc->p_s->s_t9 = (memaddr)delayDaemon;
+    ddProc->p_s->s_sp = RAMTOP - 2 * PAGESIZE; /* Stack right below test's stack */
+    ddProc->p_s->s_status = ALLOFF | IEPBITON | IM | TEBITON;
+    ddProc->p_s->s_entryHI = 0; /* Kernel ASID = 0 */
     ddProc->p_supportStruct = NULL;
+    allocPid(ddProc);
+    reserveSemd();
 
     /* Add to ready queue */
-    insertProcQ(&readyQueue, ddProc);
+    makeReady(ddProc);
 }
@@ -23,6 +23,7 @@
 #include "../h/initial.h"
 #include "../h/initProc.h"
 #include "../h/vmSupport.h"
+#include "../h/klib.h"
 
 /**
  * Performs a synchronous disk write operation (SYS14).
@@ -48,11 +49,7 @@ void dmaWriteDisk(int diskNum, int blockNum, memaddr srcAddr)
     memaddr dmaAddr = RAMSTART + (DMA_DISK_START_FRAME + diskNum) * DMA_FRAME_SIZE;
 
     /* Copy data from user space to DMA buffer */
-    char *from = (char *)srcAddr;
-    char *to = (char *)dmaAddr;
-    int i;
-    for (i = 0; i < DISK_SECTOR_SIZE; i++)
-        to[i] = from[i];
+    memcopy((void *)dmaAddr, (void *)srcAddr, DISK_SECTOR_SIZE);
 
     /* Resolve device register */
     device_t *disk = (device_t *)DEV_REG_ADDR(DISKINT, diskNum);
@@ -156,11 +153,7 @@ void dmaReadDisk(int diskNum, int blockNum, memaddr destAddr)
     }
 
     /* Copy data from DMA buffer to U-proc address */
-    char *from = (char *)dmaAddr;
-    char *to = (char *)destAddr;
-    int i;
-    for (i = 0; i < DISK_SECTOR_SIZE; i++)
-        to[i] = from[i];
+    memcopy((void *)destAddr, (void *)dmaAddr, DISK_SECTOR_SIZE);
 
     state->s_v0 = DEVICE_READY;
     LDST(state);
@@ -220,11 +213,7 @@ void dmaReadFlash(int flashNum, int blockNum, memaddr destAddr)
     }
 
     /* Copy data from DMA buffer to U-proc address */
-    char *from = (char *)dmaAddr;
-    char *to = (char *)destAddr;
-    int i;
-    for (i = 0; i < PAGESIZE; i++)
-        to[i] = from[i];
+    memcopy((void *)destAddr, (void *)dmaAddr, PAGESIZE);
 
     state->s_v0 = DEVICE_READY;
     LDST(state);
@@ -255,11 +244,7 @@ void dmaWriteFlash(int flashNum, int blockNum, memaddr srcAddr)
     memaddr dmaAddr = RAMSTART + (DMA_FLASH_START_FRAME + flashNum) * DMA_FRAME_SIZE;
 
     /* Copy data from user space to DMA buffer */
-    char *from = (char *)srcAddr;
-    char *to = (char *)dmaAddr;
-    int i;
-    for (i = 0; i < PAGESIZE; i++)
-        to[i] = from[i];
+    memcopy((void *)dmaAddr, (void *)srcAddr, PAGESIZE);
 
     /* Resolve device register */
     device_t *flash = (device_t *)DEV_REG_ADDR(FLASHINT, flashNum);
@@ -18,6 +18,10 @@
 #include "../h/scheduler.h"
 #include "../h/initial.h"
 #include "../h/const.h"
+#include "../h/smp.h"
+#include "../h/mutex.h"
+#include "../h/pid.h"
+#include "../h/klib.h"
 
 /**
  * The exception type is determined by examining the Cause register.
@@ -28,13 +32,35 @@
  */
 void exceptionHandler()
 {
+    /* Enter the nucleus, dropping TLB entries a pager has invalidated */
+    acquireLock(&globalLock);
+    syncTLB();
+
     /* Get the saved state from the BIOS Data Page */
-    state_t *savedState = (state_t *)BIOSDATAPAGE;
+    state_t *savedState = EXCSTATE(getPRID());
 
     /* Extract detailed exception information */
     unsigned int causeReg = savedState->s_cause;
     int exceptionCode = (causeReg & CAUSEMASK) >> 2;
 
+    /* The process was terminated by another CPU while it was running:
+       reap it now that this CPU no longer executes it */
+    if (currentProcess != NULL && currentProcess->p_dying)
+    {
+        freePcb(currentProcess);
+        currentProcess = NULL;
+    }
+    if (exceptionCode != 0 && currentProcess == NULL)
+    {
+        scheduler();
+    }
+
+    /* Until now the process was running its own code */
+    if (currentProcess != NULL)
+    {
+        chargeTime(currentProcess, ACCTUSER);
+    }
+
     switch (exceptionCode)
     {
     case 0: /* External Device Interrupt */
@@ -59,8 +85,8 @@ void exceptionHandler()
         break;
 
     case 8: /* SYSCALL */
-        /* Check if SYSCALL number is 9 or higher */
-        if (savedState->s_a0 >= 9)
+        /* SYSCALLs the nucleus does not serve go to the support level */
+        if (!NUCLEUSSYSCALL(savedState->s_a0))
         {
             passUpOrDie(GENERALEXCEPT);
         }
@@ -102,7 +128,7 @@ void syscallHandler(state_t *savedState)
     {
     case CREATEPROCESS:
         /* Process creation */
-        savedState->s_v0 = sysCreateProcess((state_t *)savedState->s_a1, (support_t *)savedState->s_a2);
+        savedState->s_v0 = sysCreateProcess((state_t *)savedState->s_a1, (support_t *)savedState->s_a2, savedState->s_a3);
         break;
     case TERMINATEPROCESS:
         sysTerminate(currentProcess);
@@ -110,7 +136,7 @@ void syscallHandler(state_t *savedState)
         break;
     case PASSEREN:
         /* Perform P() operation on a semaphore */
-        sysPasseren((int *)savedState->s_a1);
+        sysPasseren(savedState, (int *)savedState->s_a1);
         break;
     case VERHOGEN:
         /* Perform V() operation on a semaphore */
@@ -126,17 +152,73 @@ void syscallHandler(state_t *savedState)
         break;
     case WAITCLOCK:
         /* Block process until next pseudo-clock tick */
-        sysWaitClock();
+        sysWaitClock(savedState);
         break;
     case GETSUPPORTPTR:
         /* Return the process's support structure */
         savedState->s_v0 = (int)sysGetSupportPTR();
         break;
+    case SETPROCSHARE:
+        /* Set the CPU share of the calling process */
+        sysSetShare(savedState);
+        break;
+    case SETREALTIME:
+        /* Register the calling process as a periodic real-time task */
+        savedState->s_v0 = setRealtime(currentProcess, savedState->s_a1, savedState->s_a2);
+        break;
+    case WAITRELEASE:
+        /* End the current real-time job and wait for the next release */
+        sysWaitRelease(savedState);
+        break;
+    case GETSCHEDSTATS:
+        /* Copy the run-queue latency histograms, ASL usage and mutex hold times into the buffer in a1 */
+        sysGetSchedStats((latstats_t *)savedState->s_a1);
+        break;
+    case MUTEXP:
+        /* Lock the mutex in a1, lending the caller's priority to its owner;
+           a caller that blocks finds 0 in v0 once it gets the mutex */
+        savedState->s_v0 = 0;
+        savedState->s_v0 = sysMutexP(savedState, (int *)savedState->s_a1);
+        break;
+    case MUTEXV:
+        /* Unlock the mutex in a1 */
+        savedState->s_v0 = sysMutexV((int *)savedState->s_a1);
+        break;
+    case VERHOGENYIELD:
+        /* V() on a semaphore, handing the CPU to the woken process */
+        sysVerhogenYield(savedState);
+        break;
+    case VERHOGENALL:
+        /* Wake every process blocked on the semaphore in a1 */
+        savedState->s_v0 = sysVerhogenAll((int *)savedState->s_a1);
+        break;
+    case TERMINATEPID:
+        /* Terminate the process with the pid in a1 and its progeny */
+        savedState->s_v0 = sysTerminatePid(savedState->s_a1);
+        break;
+    case GETPID:
+        /* Return the pid of the caller */
+        savedState->s_v0 = currentProcess->p_pid;
+        break;
+    case GETCPUSTATS:
+        /* Copy the CPU time breakdown of the caller into the buffer in a1 */
+        sysGetCPUStats((cpustats_t *)savedState->s_a1);
+        break;
+    case MULTICALL:
+        /* Run the batch of a2 SYSCALLs in a1 */
+        sysMultiCall(savedState);
+        break;
+    case PASSERENTIMED:
+        /* P on the semaphore in a1, giving up after a2 microseconds */
+        sysPasserenTimed(savedState, (int *)savedState->s_a1, savedState->s_a2);
+        break;
     default:
         /* Invalid syscall, terminate the process */
         passUpOrDie(GENERALEXCEPT);
     }
 
+    chargeTime(currentProcess, ACCTKERNEL);
+    releaseLock(&globalLock);
     LDST(savedState);
 }
 
@@ -144,10 +226,12 @@ void syscallHandler(state_t *savedState)
  * Creates a new process with the provided processor state.
  * Allocates a new PCB, initializes its state, and sets its parent-child
  * relationship. The new process is then inserted into the Ready Queue
- * to be scheduled for execution.
- * Returns 0 on success, -1 if process creation fails (e.g., no available pcbs).
+ * to be scheduled for execution. A positive share sets the CPU share of the
+ * new process; 0 leaves it at DEFAULTSHARE.
+ * Returns the pid of the new process, -1 if process creation fails
+ * (no available pcbs, pids or semaphore descriptors).
  */
-int sysCreateProcess(state_t *statep, support_t *supportp)
+int sysCreateProcess(state_t *statep, support_t *supportp, int share)
 {
     /* Allocate a new PCB */
     pcb_t *newProcess = allocPcb();
@@ -156,42 +240,60 @@ int sysCreateProcess(state_t *statep, support_t *supportp)
         return -1; /* No more free pcbs, return error */
     }
 
+    /* Make sure it will always find a descriptor to block on */
+    if (!reserveSemd())
+    {
+        freePcb(newProcess);
+        return -1; /* No more semaphore descriptors, return error */
+    }
+
+    /* Give it a pid */
+    if (allocPid(newProcess) < 0)
+    {
+        unreserveSemds(1);
+        freePcb(newProcess);
+        return -1; /* Handle table full, return error */
+    }
+
     /* Initialize process state from provided state pointer */
-    memcopy(&(newProcess->p_s), statep, sizeof(state_t));
+    memcopy(newProcess->p_s, statep, sizeof(state_t));
     newProcess->p_supportStruct = supportp; /* Set support structure (NULL if not provided) */
 
     /* Initialize other process fields */
     newProcess->p_time = 0;      /* Reset CPU time */
     newProcess->p_semAdd = NULL; /* Not blocked on any semaphore */
 
+    if (share > 0)
+    {
+        setShare(newProcess, share);
+    }
+
     /* Make it a child of the current process */
     insertChild(currentProcess, newProcess);
 
     /* Insert into Ready Queue */
-    insertProcQ(&readyQueue, newProcess);
+    makeReady(newProcess);
 
     processCount++;
 
-    return 0; /* Success */
+    return newProcess->p_pid; /* Success */
 }
 
 /**
- * Terminates a process and all its progeny recursively.
- * Recursively terminates all child processes, removes the process
- * from any associated semaphores, and cleans up the process tree.
- * If the terminated process is the current process, it is set to NULL.
- * If no processes remain, the system halts.
+ * Detaches a process being terminated from everything but the process tree:
+ * the semaphore it is blocked on, the ready queues, its real-time
+ * reservation, the mutexes it holds and the CPU running it.
+ * A process running on another CPU cannot be freed while that CPU still
+ * executes it: it is marked dying instead, and its CPU reaps it on its
+ * next nucleus entry (at the latest when its time slice ends).
+ * Returns TRUE if it was soft-blocked (on a device or the pseudo-clock).
  */
-void sysTerminate(pcb_t *p)
+static int detachProcess(pcb_t *p)
 {
-    if (p == NULL)
-        return;
+    int softBlocked = FALSE;
 
-    /* Recursively terminate all children */
-    while (!emptyChild(p))
-    {
-        sysTerminate(removeChild(p));
-    }
+    /* Drop its pending timed P, if any */
+    cancelTimeout(p);
 
     /* If the process is blocked on a semaphore */
     if (p->p_semAdd != NULL)
@@ -205,38 +307,107 @@ void sysTerminate(pcb_t *p)
         }
 
         outBlocked(p);
+        dropWaiter(semAddr);
+
+        /* Waiting for I/O or the pseudo-clock counts as soft-blocked */
+        softBlocked = (semAddr >= &deviceSemaphores[0] && semAddr <= &deviceSemaphores[NUM_DEVICES]);
+    }
+
+    /* Remove process from the Ready Queue if it is in it */
+    outReady(p);
+
+    /* Give back its real-time reservation, if any */
+    dropRealtime(p);
 
-        /* If the process was soft-blocked (waiting for I/O), decrement softBlockCount */
-        if (semAddr >= &deviceSemaphores[0] && semAddr <= &deviceSemaphores[NUM_DEVICES - 1])
+    /* Hand the mutexes it holds to their next waiters */
+    releaseMutexes(p);
+
+    /* Retire its pid */
+    freePid(p);
+
+    /* If this is the current process of a CPU, stop it there */
+    int cpu;
+    for (cpu = 0; cpu < NCPU; cpu++)
+    {
+        if (p == currentProcs[cpu])
         {
-            softBlockCount--;
+            if (cpu == getPRID())
+                currentProcs[cpu] = NULL;
+            else
+                p->p_dying = TRUE;
         }
     }
 
-    /* Remove process from the Ready Queue if it is in it */
-    outProcQ(&readyQueue, p);
+    return softBlocked;
+}
+
+/**
+ * Terminates a process and all its progeny.
+ * The subtree is detached from its parent and torn down iteratively in
+ * post-order (children before their parent), so the nucleus stack use does
+ * not depend on the shape of the tree. Each process is removed from any
+ * associated semaphore and queue; the pcbs are then freed as one batch and
+ * the process counters adjusted once. If the terminated process is the
+ * current process, it is set to NULL; processes running on other CPUs are
+ * left for those CPUs to free. If no processes remain, the system halts.
+ */
+void sysTerminate(pcb_t *p)
+{
+    if (p == NULL)
+        return;
 
     /* If the process has a parent, detach it */
     if (p->p_prnt != NULL)
     {
-
         outChild(p);
     }
 
-    /* If this is the current process, clear the pointer */
-    if (p == currentProcess)
+    pcb_t *root = p;
+    pcb_t *dead = NULL; /* Terminated pcbs, linked through p_next */
+    int killed = 0, softBlocked = 0;
+
+    while (p != NULL)
     {
-        currentProcess = NULL;
+        /* Go down to a process without children */
+        if (!emptyChild(p))
+        {
+            p = p->p_child;
+            continue;
+        }
+
+        /* Tear it down, then go back to its parent */
+        pcb_t *parent = (p == root) ? NULL : p->p_prnt;
+        if (parent != NULL)
+        {
+            removeChild(parent); /* p is the first child */
+        }
+
+        if (detachProcess(p))
+        {
+            softBlocked++;
+        }
+        killed++;
+
+        /* A dying process is freed later by the CPU running it */
+        if (!p->p_dying)
+        {
+            p->p_next = dead;
+            dead = p;
+        }
+
+        p = parent;
     }
 
-    /* Free the PCB */
-    freePcb(p);
+    /* Free the PCBs */
+    freePcbs(dead);
+
+    softBlockCount -= softBlocked;
+
+    /* Their semaphore descriptor reservations are no longer needed */
+    unreserveSemds(killed);
 
     /* Decrease active process count */
-    if (processCount > 0)
-    {
-        processCount--;
-    }
+    processCount = MAX(processCount - killed, 0);
 
     /* If no more processes exist, HALT */
     if (processCount == 0)
@@ -245,13 +416,99 @@ void sysTerminate(pcb_t *p)
     }
 }
 
+/**
+ * Terminates the process with the given pid and all its progeny.
+ * Returns 0 on success, -1 if no live process has that pid. If the caller
+ * was among the terminated processes, it never returns.
+ */
+int sysTerminatePid(int pid)
+{
+    pcb_t *p = pidLookup(pid);
+    if (p == NULL)
+    {
+        return -1;
+    }
+
+    sysTerminate(p);
+
+    /* The caller may have been in the terminated subtree */
+    if (currentProcess == NULL)
+    {
+        scheduler();
+    }
+
+    return 0;
+}
+
+/**
+ * Runs a batch of SYSCALLs in one nucleus entry. a1 holds an array of a2
+ * syscall_t entries, which run in order; a3 is reserved for flags and
+ * must be 0. Each entry gets the value its SYSCALL returns in sc_result.
+ * Supported entries are PASSEREN, VERHOGEN, MUTEXP, MUTEXV, VERHOGENALL
+ * and WAITCLOCK. The batch stops early after an entry that blocks the
+ * caller, and before an unsupported one, whose sc_result is set to -1.
+ * Returns in v0 the number of entries run, or -1 (running none) if a2 is
+ * out of range or a3 is not 0.
+ */
+void sysMultiCall(state_t *savedState)
+{
+    syscall_t *batch = (syscall_t *)savedState->s_a1;
+    int count = savedState->s_a2;
+    int i;
+
+    if (count < 0 || count > MAXBATCH || savedState->s_a3 != 0)
+    {
+        savedState->s_v0 = -1;
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        syscall_t *call = &batch[i];
+
+        /* What the caller finds if this entry blocks it: the batch counts as
+           run up to this entry */
+        savedState->s_v0 = i + 1;
+        call->sc_result = 0;
+
+        switch (call->sc_num)
+        {
+        case PASSEREN:
+            sysPasseren(savedState, (int *)call->sc_a1);
+            break;
+        case VERHOGEN:
+            sysVerhogen((int *)call->sc_a1);
+            break;
+        case MUTEXP:
+            call->sc_result = sysMutexP(savedState, (int *)call->sc_a1);
+            break;
+        case MUTEXV:
+            call->sc_result = sysMutexV((int *)call->sc_a1);
+            break;
+        case VERHOGENALL:
+            call->sc_result = sysVerhogenAll((int *)call->sc_a1);
+            break;
+        case WAITCLOCK:
+            sysWaitClock(savedState);
+            break;
+        default:
+            call->sc_result = -1;
+            savedState->s_v0 = i;
+            return;
+        }
+    }
+
+    savedState->s_v0 = count;
+}
+
 /**
  * Performs the P (wait) operation on the given semaphore.
  * Decrements the semaphore value. If the resulting value is negative,
  * the calling process is blocked and placed in the semaphore's queue.
  * The scheduler is then invoked to select the next process to run.
+ * savedState is the exception state of the caller.
  */
-void sysPasseren(int *semaddr)
+void sysPasseren(state_t *savedState, int *semaddr)
 {
     /* Update CPU time */
     updateCPUTime();
@@ -262,27 +519,65 @@ void sysPasseren(int *semaddr)
     /* If semaphore is negative, block the process */
     if (*semaddr < 0)
     {
-        /* Save process state */
-        memcopy(&(currentProcess->p_s), (state_t *)BIOSDATAPAGE, sizeof(state_t));
+        saveState(savedState);
 
         /* Block current process and add it to the semaphore queue */
-        currentProcess->p_semAdd = semaddr;
+        if (insertBlocked(semaddr, currentProcess))
+        {
+            PANIC(); /* Should not happen (every process holds a descriptor reservation) */
+        }
+        currentProcess->p_blockTOD = currentProcess->p_startTOD;
 
-        insertBlocked(semaddr, currentProcess);
+        /* Blocking gives up the CPU early, so rise one MLFQ level */
+        endBurst(currentProcess);
+        promote(currentProcess);
 
         /* Call the scheduler to select the next process */
         scheduler();
     }
 }
 
+/**
+ * Performs a P on the given semaphore that gives up after timeout
+ * microseconds. Returns in v0 0 once the semaphore was taken, or
+ * SEMTIMEOUT if no V came in time; then the semaphore count is as if the
+ * P never happened. A timeout of 0 or less only takes the semaphore if
+ * that needs no wait. Device semaphores can only be waited on with WAITIO
+ * and WAITCLOCK, so they are refused with SEMTIMEOUT.
+ */
+void sysPasserenTimed(state_t *savedState, int *semaddr, int timeout)
+{
+    savedState->s_v0 = SEMTIMEOUT;
+
+    if (semaddr >= &deviceSemaphores[0] && semaddr <= &deviceSemaphores[NUM_DEVICES])
+        return;
+
+    if (*semaddr <= 0)
+    {
+        if (timeout <= 0)
+            return;
+
+        cpu_t now;
+        STCK(now);
+        addTimeout(currentProcess, (timeout > MAXINT - now) ? MAXINT : now + timeout);
+    }
+
+    /* What it returns if the semaphore is taken, now or after a V */
+    savedState->s_v0 = 0;
+    sysPasseren(savedState, semaddr);
+}
+
 /**
  * Performs the V (signal) operation on the given semaphore.
  * Increments the semaphore value. If the resulting value is zero or negative,
  * a blocked process (if any) is removed from the semaphore’s queue and moved
- * to the Ready Queue for execution.
+ * to the Ready Queue for execution. Returns the unblocked process, or NULL
+ * if no process was woken.
  */
-void sysVerhogen(int *semAddr)
+pcb_t *sysVerhogen(int *semAddr)
 {
+    pcb_t *unblockedProcess = NULL;
+
     /* Increment the semaphore value */
     (*semAddr)++;
 
@@ -290,15 +585,79 @@ void sysVerhogen(int *semAddr)
     if (*semAddr <= 0)
     {
         /* If any process is blocked on this semaphore, unblock the first one */
-        pcb_t *unblockedProcess = removeBlocked(semAddr);
+        unblockedProcess = removeBlocked(semAddr);
 
         if (unblockedProcess != NULL)
         {
             unblockedProcess->p_semAdd = NULL; /* Clear semaphore address */
 
-            insertProcQ(&readyQueue, unblockedProcess); /* Move to Ready Queue */
+            makeReady(unblockedProcess); /* Move to Ready Queue */
         }
     }
+
+    return unblockedProcess;
+}
+
+/**
+ * Broadcast V: moves every process blocked on the semaphore to the Ready
+ * Queue, raising the semaphore by the number of processes woken, so that
+ * it ends up at 0. A semaphore nobody waits on is left unchanged.
+ * Returns the number of processes woken. Does not check semAddr: waking
+ * a device semaphore is up to the interrupt handlers, which also adjust
+ * softBlockCount.
+ */
+int verhogenAll(int *semAddr)
+{
+    pcb_t *woken = mkEmptyProcQ();
+    int count = removeAllBlocked(semAddr, &woken);
+
+    *semAddr += count;
+
+    pcb_t *p;
+    while ((p = removeProcQ(&woken)) != NULL)
+    {
+        makeReady(p); /* Each one goes to the ready queue of its own level */
+    }
+
+    return count;
+}
+
+/**
+ * Serves VERHOGENALL on the semaphore at semAddr (see verhogenAll()).
+ * Returns the number of processes woken, or -1 for a device or the
+ * pseudo-clock semaphore: only the nucleus signals those, together with
+ * softBlockCount and the device status.
+ */
+int sysVerhogenAll(int *semAddr)
+{
+    if (semAddr >= &deviceSemaphores[0] && semAddr <= &deviceSemaphores[NUM_DEVICES])
+        return -1;
+
+    return verhogenAll(semAddr);
+}
+
+/**
+ * Performs a V operation on the semaphore in a1 and, if it woke a process,
+ * gives that process the rest of the caller's time slice right away; the
+ * caller goes back to the ready queue at its current level. Meant for
+ * request/response pairs where the caller is about to block on the reverse
+ * semaphore anyway. Returns in v0 1 if a process was woken, 0 otherwise.
+ */
+void sysVerhogenYield(state_t *savedState)
+{
+    pcb_t *woken = sysVerhogen((int *)savedState->s_a1);
+
+    savedState->s_v0 = (woken != NULL);
+    if (woken == NULL)
+        return;
+
+    /* Save process state and requeue the caller */
+    saveState(savedState);
+    updateCPUTime();
+    endBurst(currentProcess);
+    makeReady(currentProcess);
+
+    handOff(woken);
 }
 
 /**
@@ -328,7 +687,7 @@ void sysWaitIO(state_t *savedState, int intLineNo, int devNum, int waitForTermRe
     softBlockCount++;
 
     /* Perform P operation on the device semaphore (blocks if necessary) */
-    sysPasseren(semaddr);
+    sysPasseren(savedState, semaddr);
 
     /* Process should be blocked now; once unblocked, store device status */
     savedState->s_v0 = ((device_t *)DEV_REG_ADDR(intLineNo, devNum))->d_status;
@@ -351,16 +710,16 @@ void sysGetCPUTime(state_t *savedState)
  * semaphore. Blocks the current process on the ASL, calls the
  * scheduler.
  */
-void sysWaitClock()
+void sysWaitClock(state_t *savedState)
 {
-    /* Update CPU time */
-    updateCPUTime();
-
     /* increment softBlockCount */
     softBlockCount++;
 
+    /* The interval timer only runs while somebody waits for it */
+    armIntervalTimer(nextClockTick());
+
     /* Perform P() operation on the pseudo-clock semaphore */
-    sysPasseren(&deviceSemaphores[NUM_DEVICES]);
+    sysPasseren(savedState, &deviceSemaphores[NUM_DEVICES]);
 }
 
 /**
@@ -371,6 +730,47 @@ void *sysGetSupportPTR()
     return currentProcess->p_supportStruct;
 }
 
+/**
+ * Sets the CPU share of the current process to the ticket count in a1
+ * and returns the previous share in v0.
+ */
+void sysSetShare(state_t *savedState)
+{
+    savedState->s_v0 = setShare(currentProcess, savedState->s_a1);
+}
+
+/**
+ * Completes the current job of a real-time process and blocks it until
+ * its next release. Returns in v0 the number of jobs of the process that
+ * missed their deadline so far, or -1 if it is not a real-time process.
+ */
+void sysWaitRelease(state_t *savedState)
+{
+    if (currentProcess->p_period == 0)
+    {
+        savedState->s_v0 = -1;
+        return;
+    }
+
+    /* Update CPU time and close the burst before the job is accounted */
+    updateCPUTime();
+    endBurst(currentProcess);
+
+    if (completeJob(currentProcess))
+    {
+        savedState->s_v0 = currentProcess->p_rtMisses;
+
+        /* Save process state; it resumes at its next release */
+        saveState(savedState);
+        currentProcess->p_blockTOD = currentProcess->p_startTOD;
+
+        scheduler();
+    }
+
+    /* The next job is already due: keep running */
+    savedState->s_v0 = currentProcess->p_rtMisses;
+}
+
 /**
  * Handles program traps, terminating the offending process.
  */
@@ -388,24 +788,83 @@ void TLBExceptionHandler()
 }
 
 /**
- * Updates the CPU time for the current process.
+ * Copies the run-queue latency histograms of the current process and of
+ * the whole system into stats, with the current and peak number of
+ * semaphore descriptors on the ASL (to size semdTable against) and the
+ * hold times of the mutexes.
  */
-void updateCPUTime()
+void sysGetSchedStats(latstats_t *stats)
+{
+    getLatency(currentProcess, stats);
+    stats->ls_semdInUse = semdInUse;
+    stats->ls_semdHighWater = semdHighWater;
+    getMutexStats(stats);
+}
+
+/**
+ * Copies the CPU time breakdown of the current process, up to date to
+ * this call, into stats, with the time every CPU spent serving interrupts.
+ */
+void sysGetCPUStats(cpustats_t *stats)
+{
+    int cpu;
+
+    chargeTime(currentProcess, ACCTKERNEL);
+    memcopy(stats->cs_time, currentProcess->p_acct, sizeof(stats->cs_time));
+
+    stats->cs_interrupt = 0;
+    for (cpu = 0; cpu < NCPU; cpu++)
+        stats->cs_interrupt += interruptTime[cpu];
+}
+
+/**
+ * Charges the time of p since its last stamp (p_startTOD) to the
+ * accumulator kind and restarts the stamp. The stamp is set when p is
+ * dispatched and on every nucleus entry and exit, so time p spends in the
+ * ready queues is charged to nobody, and interrupt handling is charged to
+ * the CPU instead (see chargeInterrupt()). User and nucleus time also
+ * count in p_time (SYS6).
+ */
+void chargeTime(pcb_t *p, int kind)
 {
     unsigned int currentTOD; /* TOD clock value */
     STCK(currentTOD);        /* Read the current TOD clock value */
 
-    /* Update the accumulated CPU time */
-    currentProcess->p_time += (currentTOD - currentProcess->p_startTOD);
+    cpu_t elapsed = currentTOD - p->p_startTOD;
+    p->p_acct[kind] += elapsed;
+    p->p_time += elapsed;
 
-    /* Reset the start time for the next time slice */
-    currentProcess->p_startTOD = currentTOD;
+    /* Reset the start time for the next interval */
+    p->p_startTOD = currentTOD;
+}
+
+/**
+ * Charges the nucleus time spent so far on the current exception to the
+ * current process.
+ */
+void updateCPUTime()
+{
+    chargeTime(currentProcess, ACCTKERNEL);
+}
+
+/**
+ * Saves the exception state of the current process, which is leaving the
+ * CPU, into its save area. The BIOS has already stored the state in the
+ * BIOS data page and every nucleus path works on that in place, so this
+ * is the one copy made per exception, and only when the process stops
+ * running; resuming in place needs none.
+ */
+void saveState(state_t *savedState)
+{
+    memcopy(currentProcess->p_s, savedState, sizeof(state_t));
 }
 
 /**
  * Handles Pass Up or Die mechanism for TLB exceptions, program traps, and SYSCALLs >= 9.
  * If the current process has a support structure, it passes the exception to the support level.
  * Otherwise, the process and all its progeny are terminated.
+ * The state is copied once, straight into the support structure; the support level handlers
+ * work on it in place and resume the U-proc from there, so p_s is never touched.
  */
 void passUpOrDie(int exceptType)
 {
@@ -419,7 +878,7 @@ void passUpOrDie(int exceptType)
     else
     {
         /* Get source state */
-        state_t *savedState = (state_t *)BIOSDATAPAGE;
+        state_t *savedState = EXCSTATE(getPRID());
 
         /* Copy the saved exception state */
         memcopy(&(currentProcess->p_supportStruct->sup_exceptState[exceptType]),
@@ -427,29 +886,15 @@ void passUpOrDie(int exceptType)
                 sizeof(state_t));
 
         /* Load the exception handler's context */
+        chargeTime(currentProcess, ACCTKERNEL);
         context_t *exceptContext = &(currentProcess->p_supportStruct->sup_exceptContext[exceptType]);
+        releaseLock(&globalLock);
         LDCXT(exceptContext->c_stackPtr,
               exceptContext->c_status,
               exceptContext->c_pc);
     }
 }
 
-/**
- * Copies a block of memory from source to destination.
- * This function performs a byte-by-byte copy of `n` bytes from the
- * memory location pointed to by `src` to the memory location pointed to by `dest`.
- * It assumes that the memory regions do not overlap.
- */
-void memcopy(void *dest, const void *src, unsigned int n)
-{
-    char *d = (char *)dest;
-    const char *s = (const char *)src;
-    while (n--)
-    {
-        *d++ = *s++;
-    }
-}
-
 /*
  * This function handles TLB refill exceptions, which occur when a virtual address
  * being accessed is not mapped in the TLB. It retrieves the appropriate page table
@@ -460,7 +905,14 @@ void memcopy(void *dest, const void *src, unsigned int n)
  */
 void uTLB_RefillHandler()
 {
-    state_t *savedState = (state_t *)BIOSDATAPAGE; /* Get the saved exception state */
+    state_t *savedState = EXCSTATE(getPRID()); /* Get the saved exception state */
+
+    /* The process was terminated by another CPU while it was running */
+    if (currentProcess == NULL)
+    {
+        acquireLock(&globalLock);
+        scheduler();
+    }
 
     unsigned int entryHi = savedState->s_entryHI; /* Get the EntryHI value */
 
@@ -0,0 +1,533 @@
+/************************** hostbench.c ******************************
+ *
+ * Host-native test and benchmark harness for the process queues (pcb.c),
+ * the Active Semaphore List (asl.c) and the block memory routines
+ * (klib.c). Built and run with "make bench"
+ * from phase3/ using the host compiler; the uMPS3 pieces the two modules
+ * link against are stood in for by hoststub.c.
+ *
+ * Every workload is a random mix of insertions, head removals, removals
+ * from the middle and head lookups over a fixed set of pcbs:
+ * - queues: insertProcQ/removeProcQ/outProcQ/headProcQ over NQUEUES queues.
+ * - asl: insertBlocked/removeBlocked/outBlocked/headBlocked over NSEMS
+ *   ordinary semaphores and NDEVSEMS device semaphores, plus an occasional
+ *   removeAllBlocked, with a descriptor reservation held for every pcb.
+ * - alloc: allocPcb/freePcb churn across the static table and the slabs.
+ * - copy: memcopy/memzero over random lengths and alignments, checked
+ *   against a byte loop; then a state_t save (as on every context switch)
+ *   and a 4KB DMA bounce copy are timed against the byte loop they replaced.
+ *
+ * Each workload first runs VERIFYOPS operations against a shadow model
+ * (one FIFO per queue or semaphore), checking every result and the final
+ * drain; any mismatch aborts with a non-zero exit status. It then runs
+ * BENCHOPS operations without the model and reports operations per
+ * second and cycles per operation (rdtsc on x86, otherwise not reported).
+ *
+ * Usage: hostbench [seed]
+ ***************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#undef NULL
+
+#include "../../h/pcb.h"
+#include "../../h/asl.h"
+#include "../../h/slab.h"
+#include "../../h/klib.h"
+#include "../../h/types.h"
+#include "../../h/const.h"
+
+#define NPROCS 256     /* pcbs the workloads move around (well past MAXPROC) */
+#define NQUEUES 8      /* Process queues of the queues workload */
+#define NSEMS 56       /* Ordinary semaphores of the asl workload */
+#define NDEVSEMS 8     /* Device semaphores of the asl workload */
+#define NTARGETS (NSEMS + NDEVSEMS)
+#define VERIFYOPS 200000
+#define BENCHOPS 5000000
+#define COPYMAX 300    /* Longest block of the copy checks */
+
+/* Aborts the harness if cond does not hold */
+#define CHECK(cond, what)                                                         \
+    if (!(cond))                                                                  \
+    {                                                                             \
+        fprintf(stderr, "hostbench: %s failed (seed %u, op %ld)\n", what, seed, op); \
+        exit(1);                                                                  \
+    }
+
+extern int deviceSemaphores[];
+extern int slabLive;
+
+static unsigned int seed; /* Seed of the run, printed on failure */
+static unsigned int rng;  /* xorshift32 state */
+static long op;           /* Operation being run, printed on failure */
+
+static pcb_t *procs[NPROCS]; /* The pcbs; p_pid holds their index here */
+static int where[NPROCS];    /* Queue or semaphore each pcb is on, -1 if none */
+static pcb_t *queues[NQUEUES];
+static int sems[NSEMS];
+
+/* Shadow model: the pcb indexes on each queue or semaphore, in FIFO order */
+static int model[NTARGETS][NPROCS];
+static int modelLen[NTARGETS];
+
+/**
+ * Returns a pseudo-random number below n.
+ */
+static unsigned int rnd(unsigned int n)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng % n;
+}
+
+/**
+ * Returns the TSC, or 0 where there is none.
+ */
+static unsigned long long cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Returns the time in seconds on a monotonic clock.
+ */
+static double seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Appends pcb index i to the model of target t.
+ */
+static void modelPush(int t, int i)
+{
+    model[t][modelLen[t]++] = i;
+}
+
+/**
+ * Removes pcb index i from the model of target t.
+ */
+static void modelRemove(int t, int i)
+{
+    int k;
+    for (k = 0; model[t][k] != i; k++)
+        ;
+    for (; k < modelLen[t] - 1; k++)
+        model[t][k] = model[t][k + 1];
+    modelLen[t]--;
+}
+
+/**
+ * Returns the model's head of target t, or NULL if it is empty.
+ */
+static pcb_t *modelHead(int t)
+{
+    return modelLen[t] == 0 ? NULL : procs[model[t][0]];
+}
+
+/**
+ * Returns the address of semaphore t of the asl workload.
+ */
+static int *semAddr(int t)
+{
+    return t < NSEMS ? &sems[t] : &deviceSemaphores[t - NSEMS];
+}
+
+/**
+ * Allocates the pcbs and empties the queues, semaphores and model.
+ */
+static void setUp()
+{
+    int i;
+
+    for (i = 0; i < NPROCS; i++)
+    {
+        procs[i] = allocPcb();
+        CHECK(procs[i] != NULL, "allocPcb");
+        procs[i]->p_pid = i;
+        where[i] = -1;
+    }
+    for (i = 0; i < NQUEUES; i++)
+        queues[i] = mkEmptyProcQ();
+    for (i = 0; i < NTARGETS; i++)
+        modelLen[i] = 0;
+}
+
+/**
+ * Frees the pcbs and checks that nothing the slabs handed out is left.
+ */
+static void tearDown()
+{
+    int i;
+
+    for (i = 0; i < NPROCS; i++)
+        freePcb(procs[i]);
+
+    CHECK(slabLive == 0, "slab objects leaked");
+}
+
+/**
+ * Runs ops random operations on the process queues, checking them against
+ * the model if verify is set.
+ */
+static void runQueues(long ops, int verify)
+{
+    int i, q;
+    pcb_t *p;
+
+    setUp();
+
+    for (op = 0; op < ops; op++)
+    {
+        switch (rnd(4))
+        {
+        case 0:
+        case 1: /* Queue a pcb that is on no queue, or take one out of the middle */
+            i = rnd(NPROCS);
+            if (where[i] < 0)
+            {
+                q = rnd(NQUEUES);
+                insertProcQ(&queues[q], procs[i]);
+                where[i] = q;
+                if (verify)
+                    modelPush(q, i);
+            }
+            else
+            {
+                q = where[i];
+                p = outProcQ(&queues[q], procs[i]);
+                where[i] = -1;
+                if (verify)
+                {
+                    CHECK(p == procs[i], "outProcQ");
+                    modelRemove(q, i);
+                }
+            }
+            break;
+
+        case 2: /* Dequeue the head of a queue */
+            q = rnd(NQUEUES);
+            p = removeProcQ(&queues[q]);
+            if (p != NULL)
+                where[p->p_pid] = -1;
+            if (verify)
+            {
+                CHECK(p == modelHead(q), "removeProcQ");
+                if (p != NULL)
+                    modelRemove(q, p->p_pid);
+            }
+            break;
+
+        default: /* Look at the head of a queue */
+            q = rnd(NQUEUES);
+            p = headProcQ(queues[q]);
+            if (verify)
+                CHECK(p == modelHead(q) && emptyProcQ(queues[q]) == (modelLen[q] == 0), "headProcQ");
+            break;
+        }
+    }
+
+    /* Drain every queue in order */
+    for (q = 0; q < NQUEUES; q++)
+    {
+        while ((p = removeProcQ(&queues[q])) != NULL)
+        {
+            if (verify)
+            {
+                CHECK(p == modelHead(q), "queue drain");
+                modelRemove(q, p->p_pid);
+            }
+            where[p->p_pid] = -1;
+        }
+        if (verify)
+            CHECK(modelLen[q] == 0, "queue drain length");
+    }
+
+    tearDown();
+}
+
+/**
+ * Runs ops random operations on the ASL, checking them against the model
+ * if verify is set.
+ */
+static void runASL(long ops, int verify)
+{
+    int i, t;
+    pcb_t *p, *moved;
+
+    setUp();
+
+    /* Every pcb holds a descriptor reservation, as nucleus processes do */
+    for (i = 0; i < NPROCS; i++)
+        CHECK(reserveSemd(), "reserveSemd");
+
+    for (op = 0; op < ops; op++)
+    {
+        switch (rnd(8))
+        {
+        case 0:
+        case 1:
+        case 2:
+        case 3: /* Block a pcb that is on no semaphore, or take it out of the middle */
+            i = rnd(NPROCS);
+            if (where[i] < 0)
+            {
+                t = rnd(NTARGETS);
+                CHECK(!insertBlocked(semAddr(t), procs[i]), "insertBlocked");
+                where[i] = t;
+                if (verify)
+                    modelPush(t, i);
+            }
+            else
+            {
+                t = where[i];
+                p = outBlocked(procs[i]);
+                procs[i]->p_semAdd = NULL;
+                where[i] = -1;
+                if (verify)
+                {
+                    CHECK(p == procs[i], "outBlocked");
+                    modelRemove(t, i);
+                }
+            }
+            break;
+
+        case 4:
+        case 5: /* Wake the head of a semaphore */
+            t = rnd(NTARGETS);
+            p = removeBlocked(semAddr(t));
+            if (p != NULL)
+                where[p->p_pid] = -1;
+            if (verify)
+            {
+                CHECK(p == modelHead(t) && (p == NULL || p->p_semAdd == NULL), "removeBlocked");
+                if (p != NULL)
+                    modelRemove(t, p->p_pid);
+            }
+            break;
+
+        case 6: /* Look at the head of a semaphore */
+            t = rnd(NTARGETS);
+            p = headBlocked(semAddr(t));
+            if (verify)
+                CHECK(p == modelHead(t), "headBlocked");
+            break;
+
+        default: /* Now and then, wake a whole semaphore */
+            if (rnd(16) != 0)
+                break;
+            t = rnd(NTARGETS);
+            moved = mkEmptyProcQ();
+            i = removeAllBlocked(semAddr(t), &moved);
+            if (verify)
+                CHECK(i == modelLen[t], "removeAllBlocked count");
+            while ((p = removeProcQ(&moved)) != NULL)
+            {
+                if (verify)
+                {
+                    CHECK(p == modelHead(t) && p->p_semAdd == NULL, "removeAllBlocked order");
+                    modelRemove(t, p->p_pid);
+                }
+                where[p->p_pid] = -1;
+            }
+            break;
+        }
+    }
+
+    /* Drain every semaphore in order */
+    for (t = 0; t < NTARGETS; t++)
+    {
+        while ((p = removeBlocked(semAddr(t))) != NULL)
+        {
+            if (verify)
+            {
+                CHECK(p == modelHead(t), "semaphore drain");
+                modelRemove(t, p->p_pid);
+            }
+            where[p->p_pid] = -1;
+        }
+        if (verify)
+            CHECK(modelLen[t] == 0 && headBlocked(semAddr(t)) == NULL, "semaphore drain length");
+    }
+    CHECK(semdInUse == 0 && semdHighWater <= NSEMS, "semdInUse after drain");
+
+    /* The spares taken from the slabs must go back to them */
+    unreserveSemds(NPROCS);
+    tearDown();
+}
+
+/**
+ * Runs ops random pcb allocations and frees; verify additionally checks
+ * that live pcbs are distinct and come back reset.
+ */
+static void runAlloc(long ops, int verify)
+{
+    pcb_t *live[NPROCS];
+    int count = 0, k;
+
+    for (op = 0; op < ops; op++)
+    {
+        if (count == 0 || (count < NPROCS && rnd(2) == 0))
+        {
+            pcb_t *p = allocPcb();
+            CHECK(p != NULL, "allocPcb");
+            if (verify)
+            {
+                CHECK(p->p_next == NULL && p->p_queue == NULL && p->p_semAdd == NULL &&
+                          p->p_prnt == NULL && p->p_child == NULL && p->p_s != NULL,
+                      "allocPcb reset");
+                for (k = 0; k < count; k++)
+                    CHECK(live[k] != p, "allocPcb handed out a live pcb");
+            }
+            p->p_next = p; /* Dirty it for the next reset check */
+            live[count++] = p;
+        }
+        else
+        {
+            k = rnd(count);
+            freePcb(live[k]);
+            live[k] = live[--count];
+        }
+    }
+
+    while (count > 0)
+        freePcb(live[--count]);
+
+    CHECK(slabLive == 0, "slab objects leaked");
+}
+
+/**
+ * The byte-at-a-time copy memcopy() used to be.
+ */
+static void byteCopy(void *dest, const void *src, unsigned int n)
+{
+    char *d = (char *)dest;
+    const char *s = (const char *)src;
+    while (n--)
+    {
+        *d++ = *s++;
+    }
+}
+
+/**
+ * Checks memcopy and memzero on ops random blocks against byteCopy, with
+ * every mix of source and destination alignment.
+ */
+static void checkCopy(long ops)
+{
+    static unsigned char src[COPYMAX + WORDLEN], dst[COPYMAX + 2 * WORDLEN], ref[COPYMAX + 2 * WORDLEN];
+    unsigned int k;
+
+    for (op = 0; op < ops; op++)
+    {
+        unsigned int n = rnd(COPYMAX + 1), so = rnd(WORDLEN), dof = rnd(WORDLEN);
+
+        for (k = 0; k < sizeof(src); k++)
+            src[k] = (unsigned char)rnd(256);
+        for (k = 0; k < sizeof(dst); k++)
+            dst[k] = ref[k] = (unsigned char)k;
+
+        if (rnd(2))
+        {
+            memcopy(dst + dof, src + so, n);
+            byteCopy(ref + dof, src + so, n);
+        }
+        else
+        {
+            memzero(dst + dof, n);
+            for (k = 0; k < n; k++)
+                ref[dof + k] = 0;
+        }
+
+        for (k = 0; k < sizeof(dst); k++)
+            CHECK(dst[k] == ref[k], "memcopy/memzero");
+    }
+}
+
+/**
+ * Times reps copies of n bytes with copy and returns the cycles (or, with
+ * no TSC, the nanoseconds) per copy.
+ */
+static double timeCopy(void (*copy)(void *, const void *, unsigned int), void *dest, const void *src,
+                       unsigned int n, long reps)
+{
+    long r;
+    double start = seconds();
+    unsigned long long startCycles = cycles();
+
+    for (r = 0; r < reps; r++)
+        copy(dest, src, n);
+
+    unsigned long long elapsedCycles = cycles() - startCycles;
+    double elapsed = seconds() - start;
+
+    return elapsedCycles != 0 ? (double)elapsedCycles / reps : elapsed * 1e9 / reps;
+}
+
+/**
+ * Verifies the block routines, then times them against the byte loop.
+ */
+static void runCopy()
+{
+    static unsigned int from[PAGESIZE / WORDLEN], to[PAGESIZE / WORDLEN];
+    const char *unit = cycles() != 0 ? "cycles" : "ns";
+
+    checkCopy(VERIFYOPS / 10);
+
+    printf("copy     ok  state_t: %7.1f -> %7.1f %s  4KB: %8.1f -> %8.1f %s\n",
+           timeCopy(byteCopy, to, from, sizeof(state_t), BENCHOPS / 5),
+           timeCopy(memcopy, to, from, sizeof(state_t), BENCHOPS / 5), unit,
+           timeCopy(byteCopy, to, from, PAGESIZE, BENCHOPS / 500),
+           timeCopy(memcopy, to, from, PAGESIZE, BENCHOPS / 500), unit);
+}
+
+/**
+ * Verifies one workload, then times it and prints the results.
+ */
+static void run(const char *name, void (*workload)(long, int))
+{
+    workload(VERIFYOPS, TRUE);
+
+    double start = seconds();
+    unsigned long long startCycles = cycles();
+    workload(BENCHOPS, FALSE);
+    unsigned long long elapsedCycles = cycles() - startCycles;
+    double elapsed = seconds() - start;
+
+    printf("%-8s ok  %10.0f ops/s", name, BENCHOPS / elapsed);
+    if (elapsedCycles != 0)
+        printf("  %8.1f cycles/op", (double)elapsedCycles / BENCHOPS);
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    seed = (argc > 1) ? (unsigned int)strtoul(argv[1], 0, 0) : (unsigned int)time(0);
+    if (seed == 0)
+        seed = 1; /* xorshift never leaves 0 */
+    rng = seed;
+
+    printf("hostbench: seed %u, %d pcbs, %d verified + %d timed ops per workload\n",
+           seed, NPROCS, VERIFYOPS, BENCHOPS);
+
+    initSlabs();
+    initPcbs();
+    initASL();
+
+    run("queues", runQueues);
+    run("asl", runASL);
+    run("alloc", runAlloc);
+    runCopy();
+
+    return 0;
+}
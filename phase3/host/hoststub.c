@@ -0,0 +1,91 @@
+/************************** hoststub.c ******************************
+ *
+ * Host stand-ins for the nucleus pieces pcb.c and asl.c link against,
+ * used only by the host-native harness (make bench).
+ *
+ * - deviceSemaphores is defined here, as initial.c does in the nucleus.
+ * - The slab caches are backed by malloc(): every object carries a small
+ *   header naming its cache, so slabOwns() answers exactly like the real
+ *   allocator. slabLive counts the objects not given back yet, so the
+ *   harness can check that nothing leaks.
+ ***************************************************************/
+
+#include <stdlib.h>
+#undef NULL
+
+#include "../../h/initial.h"
+#include "../../h/slab.h"
+#include "../../h/types.h"
+#include "../../h/const.h"
+
+#define SLABMAGIC 0x51AB51AB
+
+/* Header in front of every object handed out by slabAlloc() */
+typedef struct hostobj_t
+{
+    slabcache_t *o_cache;
+    unsigned int o_magic;
+    double o_align; /* Keeps the object that follows suitably aligned */
+} hostobj_t;
+
+int deviceSemaphores[NUM_DEVICES + 1];
+
+slabcache_t pcbSlabs;
+slabcache_t semdSlabs;
+slabcache_t stateSlabs;
+
+int slabLive; /* Objects handed out and not freed yet */
+
+/**
+ * Sets up the pcb, semd and save area caches.
+ */
+void initSlabs()
+{
+    pcbSlabs.sc_objSize = sizeof(pcb_t);
+    semdSlabs.sc_objSize = sizeof(semd_t);
+    stateSlabs.sc_objSize = sizeof(state_t);
+    slabLive = 0;
+}
+
+/**
+ * Returns a new object of cache, or NULL if the host is out of memory.
+ */
+void *slabAlloc(slabcache_t *cache)
+{
+    hostobj_t *obj = (hostobj_t *)malloc(sizeof(hostobj_t) + cache->sc_objSize);
+    if (obj == 0)
+        return NULL;
+
+    obj->o_cache = cache;
+    obj->o_magic = SLABMAGIC;
+    slabLive++;
+
+    return (void *)(obj + 1);
+}
+
+/**
+ * Returns an object obtained from slabAlloc().
+ */
+void slabFree(void *obj)
+{
+    hostobj_t *header = (hostobj_t *)obj - 1;
+
+    if (header->o_magic != SLABMAGIC)
+        abort(); /* Not a slab object, or freed twice */
+
+    header->o_magic = 0;
+    free(header);
+    slabLive--;
+}
+
+/**
+ * Returns TRUE if obj was handed out by slabAlloc() for cache.
+ * Like the nucleus, callers only ask about descriptors they got from the
+ * ASL or the slabs, so reading the header in front of obj is safe.
+ */
+int slabOwns(slabcache_t *cache, void *obj)
+{
+    hostobj_t *header = (hostobj_t *)obj - 1;
+
+    return header->o_magic == SLABMAGIC && header->o_cache == cache;
+}
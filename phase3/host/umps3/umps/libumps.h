@@ -0,0 +1,19 @@
+#ifndef HOST_LIBUMPS
+#define HOST_LIBUMPS
+
+/************************* LIBUMPS.H *****************************
+ *
+ *  Host stand-in for the uMPS3 libumps header, used only by the
+ *  host-native harness (make bench).
+ *
+ *  pcb.c and asl.c call no libumps service; they only reach this
+ *  header through initial.h, so the declarations below are the
+ *  ones that header relies on and none of them is linked.
+ *
+ */
+
+extern unsigned int getPRID();
+
+/***************************************************************/
+
+#endif
@@ -132,11 +132,11 @@ void initUProcs()
         support->sup_exceptContext[GENERALEXCEPT].c_pc = (memaddr)supportGenExceptionHandler;
 
         /* Set entry point and SP for the U-proc */
-        newProc->p_s.s_pc = UPROC_START;                                     /* Program counter */
-        newProc->p_s.s_t9 = UPROC_START;                                     /* t9 is also set to entry point */
-        newProc->p_s.s_sp = UPROC_STACK;                                     /* Stack pointer */
-        newProc->p_s.s_status = ALLOFF | IEPBITON | IM | TEBITON | KUPBITON; /* User mode with enabled timer */
-        newProc->p_s.s_entryHI = newProc->p_s.s_entryHI | (i << ASID_SHIFT); /* Encode ASID in EntryHI */
+        newProc->p_s->s_pc = UPROC_START;                                     /* Program counter */
+        newProc->p_s->s_t9 = UPROC_START;                                     /* t9 is also set to entry point */
+        newProc->p_s->s_sp = UPROC_STACK;                                     /* Stack pointer */
+        newProc->p_s->s_status = ALLOFF | IEPBITON | IM | TEBITON | KUPBITON; /* User mode with enabled timer */
+        newProc->p_s->s_entryHI = newProc->p_s->s_entryHI | (i << ASID_SHIFT); /* Encode ASID in EntryHI */
     }
 }
 
@@ -199,8 +199,8 @@ void initSupportStructs()
 
 /*
  * Starts all user-level processes and waits for them to complete.
- * Each process is created using CREATEPROCESS (SYS1) and synchronization
- * is handled using the master semaphore.
+ * Each process is created using CREATEPROCESS (SYS1) with its CPU share
+ * and synchronization is handled using the master semaphore.
  */
 void test()
 {
@@ -209,7 +209,7 @@ void test()
     /* Start each user process (1 through 8) */
     for (i = 1; i <= UPROCMAX; i++)
     {
-        int result = SYSCALL(CREATEPROCESS, (int)&(asidProcessTable[i]->p_s), (int)(asidProcessTable[i]->p_supportStruct), 0);
+        int result = SYSCALL(CREATEPROCESS, (int)asidProcessTable[i]->p_s, (int)(asidProcessTable[i]->p_supportStruct), DEFAULTSHARE);
         if (result < 0)
         {
             PANIC();
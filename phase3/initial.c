@@ -20,12 +20,18 @@
 #include "../h/sysSupport.h"
 #include "../h/delayDaemon.h"
 #include "../h/deviceSupportDMA.h"
+#include "../h/smp.h"
+#include "../h/mutex.h"
+#include "../h/slab.h"
+#include "../h/pid.h"
 
 /* Global Variables */
 int processCount = 0;                        /* Active process count */
 int softBlockCount = 0;                      /* Soft-blocked process count */
-pcb_t *readyQueue = NULL;                    /* Tail pointer to ready queue */
-pcb_t *currentProcess = NULL;                /* Currently running process */
+pcb_t *readyQueues[NCPU][NUMPRIOLEVELS];     /* Tail pointers to each CPU's MLFQ ready queues */
+int readyCount[NCPU];                        /* Number of ready processes queued on each CPU */
+int shortReadyCount[NCPU];                   /* Latency-sensitive ready processes queued on each CPU */
+pcb_t *currentProcs[NCPU];                   /* Process running on each CPU */
 int deviceSemaphores[NUM_DEVICES + 1] = {0}; /* Device semaphores (extra one for pseudo-clock) */
 
 
@@ -33,10 +39,11 @@ int deviceSemaphores[NUM_DEVICES + 1] = {0}; /* Device semaphores (extra one for
  The `main` function serves as the starting point of the kernel, responsible for:
  * - Initializing global process management variables.
  * - Setting up the Pass Up Vector for handling TLB refills and exceptions.
- * - Initializing Phase 1 data structures (Pcbs and ASL).
+ * - Initializing Phase 1 data structures (slab caches, Pcbs, ASL, mutexes and pids).
  * - Initializing device semaphores for I/O synchronization.
- * - Setting up the system timer for periodic interrupts.
- * - Creating the initial user process and handing control to the scheduler.
+ * - Parking the interval timer until the first timed wait.
+ * - Creating the initial user process, booting the secondary CPUs and handing
+ *   control to the scheduler.
  * - Entering an infinite loop if the scheduler returns (which should never happen).
  */
 void main()
@@ -44,33 +51,53 @@ void main()
     /* Initialize Global Variables */
     processCount = 0;
     softBlockCount = 0;
-    readyQueue = mkEmptyProcQ();
-    currentProcess = NULL;
 
-    /* Get the Pass Up Vector from BIOS Data Page */
+    int i, j;
+    for (i = 0; i < NCPU; i++)
+    {
+        currentProcs[i] = NULL;
+        readyCount[i] = 0;
+        shortReadyCount[i] = 0;
+        for (j = 0; j < NUMPRIOLEVELS; j++)
+        {
+            readyQueues[i][j] = mkEmptyProcQ();
+        }
+    }
+
+    /* Nobody else may touch nucleus data until the first dispatch releases it */
+    acquireLock(&globalLock);
+
+    /* Get the Pass Up Vector from BIOS Data Page (one per CPU) */
     passupvector_t *passupvector = (passupvector_t *)PASSUPVECTOR;
 
-    /* Set the TLB Refill event handler */
-    passupvector->tlb_refll_handler = (memaddr)uTLB_RefillHandler;
-    passupvector->tlb_refll_stackPtr = (memaddr)0x20001000;
+    for (i = 0; i < NCPU; i++, passupvector++)
+    {
+        memaddr stackPtr = (i == 0) ? NUCLEUSSTACK : CPUSTACK(i);
 
-    /* Set the Exception handler */
-    passupvector->exception_handler = (memaddr)exceptionHandler;
-    passupvector->exception_stackPtr = (memaddr)0x20001000;
+        /* Set the TLB Refill event handler */
+        passupvector->tlb_refll_handler = (memaddr)uTLB_RefillHandler;
+        passupvector->tlb_refll_stackPtr = stackPtr;
+
+        /* Set the Exception handler */
+        passupvector->exception_handler = (memaddr)exceptionHandler;
+        passupvector->exception_stackPtr = stackPtr;
+    }
 
     /* Initialize Phase 1 data structures */
+    initSlabs();
     initPcbs();
     initASL();
+    initMutexes();
+    initPids();
 
     /* Initialize Nucleus variables */
-    int i;
     for (i = 0; i < NUM_DEVICES + 1; i++)
     {
         deviceSemaphores[i] = 0;
     }
 
-    /* Load the Interval Timer with 100 milliseconds */
-    LDIT(CLOCKINTERVAL);
+    /* Park the Interval Timer until the first timed wait */
+    initIntervalTimer();
 
     /* Create Initial Process */
     createProcess();
@@ -84,6 +111,9 @@ void main()
     /* Initialize U-procs*/
     initUProcs();
 
+    /* Start the other processors; they wait on the nucleus lock */
+    bootSecondaryCPUs();
+
     /* Start Scheduler */
     scheduler();
 
@@ -108,11 +138,14 @@ void createProcess()
         PANIC(); /* Should not happen (no available pcb) */
     }
 
+    allocPid(p);  /* First pid ever issued, cannot fail */
+    reserveSemd(); /* semdTable is all spare at boot, cannot fail */
+
     /* Initialize Processor State */
-    p->p_s.s_status = IEPBITON | IM | TEBITON; /* Enable Interrupts, Timer */
-    p->p_s.s_sp = RAMTOP;                      /* Set Stack Pointer to RAMTOP */
-    p->p_s.s_pc = (memaddr)test;               /* Set Program Counter to `test` */
-    p->p_s.s_t9 = (memaddr)test;               /* Assign t9 register to `test` */
+    p->p_s->s_status = IEPBITON | IM | TEBITON; /* Enable Interrupts, Timer */
+    p->p_s->s_sp = RAMTOP;                      /* Set Stack Pointer to RAMTOP */
+    p->p_s->s_pc = (memaddr)test;               /* Set Program Counter to `test` */
+    p->p_s->s_t9 = (memaddr)test;               /* Assign t9 register to `test` */
 
     /* Initialize pcb fields */
     p->p_prnt = NULL;          /* No parent */
@@ -121,10 +154,13 @@ void createProcess()
     p->p_sib_right = NULL;     /* No right sibling */
     p->p_time = 0;             /* Reset accumulated time */
     p->p_semAdd = NULL;        /* Not blocked on any semaphore */
+    p->p_prio = 0;             /* Start on the highest MLFQ level */
+    p->p_cpu = 0;              /* Start on the boot CPU */
+    p->p_burst = QUANTUM / 2;  /* First time slice is the default one */
     p->p_supportStruct = NULL; /* No support structure */
 
     /* Insert into Ready Queue */
-    insertProcQ(&readyQueue, p);
+    makeReady(p);
     processCount++; /* Increment process count */
 }
 
@@ -6,6 +6,25 @@
  * pending interrupt and processing device-specific events. It ensures proper
  * synchronization through semaphore operations and facilitates process scheduling
  * when necessary.
+ *
+ * The interval timer is programmed on demand rather than ticking every
+ * CLOCKINTERVAL: it is armed only while some process waits on the
+ * pseudo-clock or a real-time release is pending, for whichever of the two
+ * comes first, and parked otherwise. Pseudo-clock ticks keep their phase
+ * (multiples of CLOCKINTERVAL since boot), so SYS7 still waits for the next
+ * 100ms boundary.
+ *
+ * Timed P operations (PASSERENTIMED) keep their deadlines in timeoutQ, a
+ * doubly linked list sorted by deadline. The interval timer is armed for
+ * the earliest one too; when it passes, the process is pulled off its
+ * semaphore through the queue it records (no ASL lookup), the count is
+ * given back and the P returns SEMTIMEOUT. A V that wakes the process
+ * first cancels the timeout in constant time. Pending timeouts count as
+ * soft-blocked processes, so the scheduler waits for them instead of
+ * declaring a deadlock.
+ *
+ * Time spent serving interrupts is charged to the CPU that served them
+ * (interruptTime), never to the process that happened to be interrupted.
  ***************************************************************/
 
 #include "../h/exceptions.h"
@@ -16,6 +35,167 @@
 #include "../h/initial.h"
 #include "../h/interrupts.h"
 #include "../h/const.h"
+#include "../h/smp.h"
+#include "../h/mutex.h"
+
+static cpu_t nextTickTOD; /* TOD of the first pseudo-clock tick after the last one delivered */
+static cpu_t armedFor;    /* TOD the interval timer is armed for, -1 if parked */
+static pcb_t *timeoutQ;   /* Pending timed Ps, earliest deadline first (NULL if none) */
+static cpu_t intStartTOD[NCPU]; /* Start of the interrupt time not charged yet, per CPU */
+
+cpu_t interruptTime[NCPU]; /* Time each CPU spent serving interrupts */
+
+/**
+ * Parks the interval timer and sets the phase of the pseudo-clock.
+ * Called once during nucleus initialization.
+ */
+void initIntervalTimer()
+{
+    STCK(nextTickTOD);
+    nextTickTOD += CLOCKINTERVAL;
+    armedFor = -1;
+    timeoutQ = NULL;
+    PARKIT();
+}
+
+/**
+ * Returns the TOD of the first pseudo-clock tick after the TOD t, which is
+ * not earlier than the last tick delivered. Ticks nobody waited for while
+ * the timer was parked are skipped.
+ */
+static cpu_t tickAfter(cpu_t t)
+{
+    if (t < nextTickTOD)
+        return nextTickTOD;
+
+    return nextTickTOD + ((t - nextTickTOD) / CLOCKINTERVAL + 1) * CLOCKINTERVAL;
+}
+
+/**
+ * Returns the TOD of the pseudo-clock tick owed to the processes waiting
+ * for it: the first tick after the oldest of them blocked, or the first
+ * tick still to come if nobody waits. The tick may be due already if its
+ * interrupt is still pending. Only handleIntervalTimerInterrupt() moves
+ * the pseudo-clock on, when it delivers a tick.
+ */
+cpu_t nextClockTick()
+{
+    pcb_t *oldest = headBlocked(&deviceSemaphores[NUM_DEVICES]);
+    cpu_t since;
+
+    if (oldest != NULL)
+        since = oldest->p_blockTOD;
+    else
+        STCK(since);
+
+    return tickAfter(since);
+}
+
+/**
+ * Makes sure the interval timer fires no later than the TOD when.
+ */
+void armIntervalTimer(cpu_t when)
+{
+    if (armedFor >= 0 && armedFor <= when)
+        return;
+
+    cpu_t now;
+    STCK(now);
+
+    armedFor = when;
+    LDIT(MAX(when - now, 1));
+}
+
+/**
+ * Starts the timeout of p, which is about to block in a timed P, for the
+ * TOD deadline. Deadlines that tie keep their arrival order.
+ */
+void addTimeout(pcb_t *p, cpu_t deadline)
+{
+    pcb_t *prev = NULL;
+    pcb_t *next = timeoutQ;
+
+    while (next != NULL && next->p_timeout <= deadline)
+    {
+        prev = next;
+        next = next->p_tmNext;
+    }
+
+    p->p_timeout = deadline;
+    p->p_tmPrev = prev;
+    p->p_tmNext = next;
+    if (prev != NULL)
+        prev->p_tmNext = p;
+    else
+        timeoutQ = p;
+    if (next != NULL)
+        next->p_tmPrev = p;
+
+    softBlockCount++;
+    armIntervalTimer(deadline);
+}
+
+/**
+ * Cancels the pending timeout of p, if any.
+ */
+void cancelTimeout(pcb_t *p)
+{
+    if (p->p_timeout == 0)
+        return;
+
+    if (p->p_tmPrev != NULL)
+        p->p_tmPrev->p_tmNext = p->p_tmNext;
+    else
+        timeoutQ = p->p_tmNext;
+    if (p->p_tmNext != NULL)
+        p->p_tmNext->p_tmPrev = p->p_tmPrev;
+
+    p->p_timeout = 0;
+    p->p_tmNext = NULL;
+    p->p_tmPrev = NULL;
+    softBlockCount--;
+}
+
+/**
+ * Ends every timed P whose deadline is not after now: the process leaves
+ * its semaphore, which gets back the unit the P took, and becomes ready
+ * with SEMTIMEOUT in v0.
+ */
+static void expireTimeouts(cpu_t now)
+{
+    while (timeoutQ != NULL && timeoutQ->p_timeout <= now)
+    {
+        pcb_t *p = timeoutQ;
+        cancelTimeout(p);
+
+        int *semAddr = p->p_semAdd;
+        (*semAddr)++;
+        outBlocked(p);
+        p->p_semAdd = NULL;
+        dropWaiter(semAddr);
+
+        p->p_s->s_v0 = SEMTIMEOUT;
+        makeReady(p);
+    }
+}
+
+/**
+ * Charges the time spent so far serving the current interrupt to the
+ * executing CPU in interruptTime, not to the process it interrupted,
+ * whose own stamp restarts. Called before the handler leaves the nucleus.
+ */
+void chargeInterrupt()
+{
+    int cpu = getPRID();
+    cpu_t now;
+    STCK(now);
+
+    interruptTime[cpu] += now - intStartTOD[cpu];
+    intStartTOD[cpu] = now;
+
+    if (currentProcess != NULL)
+        currentProcess->p_startTOD = now;
+}
 
 /**
  * Handles external interrupts by identifying the highest-priority pending interrupt
@@ -26,8 +206,11 @@
  */
 void interruptHandler()
 {
+    /* Interrupt time from here on is charged to the CPU */
+    STCK(intStartTOD[getPRID()]);
+
     /* Get the saved state from the BIOS Data Page */
-    state_t *savedState = (state_t *)BIOSDATAPAGE;
+    state_t *savedState = EXCSTATE(getPRID());
 
     /* Determine the highest priority pending interrupt */
     int intLine = getHighestPriorityInterrupt(savedState->s_cause);
@@ -57,30 +240,64 @@ void interruptHandler()
         PANIC(); /* This should never happen */
     }
 
+    /* Nothing to resume if the CPU was idle or its process was terminated */
+    if (currentProcess == NULL)
+    {
+        chargeInterrupt();
+        scheduler();
+    }
+
     /* Restore the interrupted process */
+    chargeInterrupt();
+    releaseLock(&globalLock);
     LDST(savedState);
 }
 
 /**
- * Handles PLT interrupts by reloading the timer, saving the process state, updating CPU time,
- * moving the process to the Ready Queue, and invoking the scheduler.
+ * Preempts the current process if a ready process outranks it: a released
+ * real-time job with an earlier deadline, or a process on a higher MLFQ level.
+ * Returns only if the current process keeps the CPU.
+ */
+static void preemptIfOutranked()
+{
+    if (!outranked(currentProcess))
+        return;
+
+    saveState(EXCSTATE(getPRID()));
+    chargeInterrupt();
+    endBurst(currentProcess);
+    makeReady(currentProcess);
+    scheduler();
+}
+
+/**
+ * Handles PLT interrupts by reloading the timer, updating CPU time and moving the process
+ * one MLFQ level down. If no other process is ready it simply resumes; otherwise its state
+ * is saved, it goes back to the Ready Queue, and the scheduler is invoked.
  */
 void handlePLTInterrupt()
 {
     /* Acknowledge the PLT interrupt by reloading the timer */
-    setTIMER(5000); /* Load PLT with 5ms */
+    setTIMER(QUANTUM);
 
     /* Check if there's a current process */
     if (currentProcess != NULL)
     {
-        /* Save process state */
-        memcopy(&(currentProcess->p_s), (state_t *)BIOSDATAPAGE, sizeof(state_t));
+        /* Charge the handling of the interrupt */
+        chargeInterrupt();
+
+        /* The whole time slice was used up, so drop one MLFQ level */
+        endBurst(currentProcess);
+        demote(currentProcess);
 
-        /* Update CPU time */
-        updateCPUTime();
+        /* Without a competitor, keep running in place */
+        resumeIfAlone(currentProcess);
+
+        /* Save process state */
+        saveState(EXCSTATE(getPRID()));
 
         /* Move the process to the Ready Queue */
-        insertProcQ(&readyQueue, currentProcess);
+        makeReady(currentProcess);
     }
 
     /* Call the Scheduler */
@@ -88,36 +305,56 @@ void handlePLTInterrupt()
 }
 
 /**
- * Handles Interval Timer interrupts by reloading the timer, unblocking all processes
- * waiting on the Pseudo-clock semaphore, resetting the semaphore, and restoring execution.
+ * Handles Interval Timer interrupts. On a pseudo-clock tick, unblocks all processes
+ * waiting on the Pseudo-clock semaphore and resets the semaphore. Then releases due
+ * real-time jobs, ends expired timed Ps, re-arms the timer for the next pending event (or parks it), and
+ * restores execution (or preempts the current process in favour of a higher-ranked one).
  */
 void handleIntervalTimerInterrupt()
 {
-    /* Acknowledge the Interval Timer interrupt by reloading the timer */
-    LDIT(CLOCKINTERVAL); /* Reload Interval Timer with 100ms */
+    cpu_t now;
+    STCK(now);
+
+    /* Acknowledge the Interval Timer interrupt by parking the timer */
+    PARKIT();
+    armedFor = -1;
 
-    /* Unblock all processes waiting on the Pseudo-clock semaphore */
-    while (headBlocked(&deviceSemaphores[NUM_DEVICES]) != NULL)
+    if (headBlocked(&deviceSemaphores[NUM_DEVICES]) != NULL && now >= nextClockTick())
     {
-        pcb_t *unblockedProcess = removeBlocked(&deviceSemaphores[NUM_DEVICES]);
-        if (unblockedProcess != NULL)
-        {
-            insertProcQ(&readyQueue, unblockedProcess); /* Move process to Ready Queue */
-        }
+        /* Unblock all processes waiting on the Pseudo-clock semaphore at once,
+           which also brings the semaphore back to 0 */
+        softBlockCount -= verhogenAll(&deviceSemaphores[NUM_DEVICES]);
+        nextTickTOD = tickAfter(now);
     }
 
-    /* Reset the Pseudo-clock semaphore to 0 */
-    deviceSemaphores[NUM_DEVICES] = 0;
+    releaseJobs();
+    expireTimeouts(now);
+
+    /* Re-arm for the next tick somebody waits for, the next release and the next timeout */
+    if (headBlocked(&deviceSemaphores[NUM_DEVICES]) != NULL)
+        armIntervalTimer(nextClockTick());
+
+    cpu_t release = nextRelease();
+    if (release >= 0)
+        armIntervalTimer(release);
+
+    if (timeoutQ != NULL)
+        armIntervalTimer(timeoutQ->p_timeout);
 
     /* Restore execution state (LDST to return control) */
     if (currentProcess != NULL)
     {
-        state_t *savedState = (state_t *)BIOSDATAPAGE;
+        preemptIfOutranked();
+
+        state_t *savedState = EXCSTATE(getPRID());
+        chargeInterrupt();
+        releaseLock(&globalLock);
         LDST(savedState);
     }
     else
     {
         /* If no process is running, call the Scheduler */
+        chargeInterrupt();
         scheduler();
     }
 }
@@ -125,6 +362,7 @@ void handleIntervalTimerInterrupt()
 /**
  * Handles device interrupts by identifying the highest-priority device, saving its status,
  * acknowledging the interrupt, unblocking any waiting process, and restoring execution.
+ * If the unblocked process outranks the current one, the current process is preempted instead.
  */
 void handleDeviceInterrupt(int intLine)
 {
@@ -187,24 +425,30 @@ void handleDeviceInterrupt(int intLine)
         if (unblockedProcess != NULL)
         {
             /* Store the device's status register value in v0 of the unblocked process */
-            unblockedProcess->p_s.s_v0 = status;
+            unblockedProcess->p_s->s_v0 = status;
 
             /* Decrement the soft block count since a process is being unblocked */
             softBlockCount--;
 
             /* Move the unblocked process to the Ready Queue */
-            insertProcQ(&readyQueue, unblockedProcess);
+            makeReady(unblockedProcess);
         }
 
         /* If there's no current process, call the scheduler */
         if (currentProcess == NULL)
         {
+            chargeInterrupt();
             scheduler();
         }
         else
         {
+            /* The woken process may outrank the current one */
+            preemptIfOutranked();
+
             /* Return control to the Current Process */
-            LDST((state_t *)BIOSDATAPAGE);
+            chargeInterrupt();
+            releaseLock(&globalLock);
+            LDST(EXCSTATE(getPRID()));
         }
     }
 }
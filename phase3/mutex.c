@@ -0,0 +1,280 @@
+/************************** mutex.c ******************************
+ *
+ * This file implements owner-tracking mutexes with priority inheritance,
+ * served by the MUTEXP (SYS36) and MUTEXV (SYS37) nucleus SYSCALLs.
+ * A mutex is an ordinary binary semaphore (initialized to 1) that is only
+ * ever locked and unlocked through these two calls; the support level uses
+ * them for its device, swap pool and delay list semaphores.
+ *
+ * Implementation Summary:
+ * - mutexTable records, for each semaphore used as a mutex, its current
+ *   owner and hold time statistics, which GETLATENCY reports summed over
+ *   all mutexes. Entries are claimed on first use; MUTEXP fails once the
+ *   table is full.
+ * - While higher-priority processes wait for a mutex, its owner runs at
+ *   the MLFQ level of the best of them (real-time waiters count as level
+ *   0). The boost is passed on along a chain of owners blocked on other
+ *   mutexes, and dropped when the owner releases the mutex, keeping what
+ *   the waiters of the mutexes it still holds require. While boosted, the
+ *   level the owner earns on its own is kept in p_basePrio, where the MLFQ
+ *   keeps moving it (see setPrio() in scheduler.c). A waiter that times
+ *   out or is terminated takes its contribution to the boost with it.
+ * - MUTEXV hands the mutex directly to the first waiter; a process that
+ *   does not own the mutex cannot release it, and neither can anyone
+ *   release a semaphore that was never locked through MUTEXP.
+ * - A terminated owner releases every mutex it holds.
+ ***************************************************************/
+
+#include "../h/mutex.h"
+#include "../h/asl.h"
+#include "../h/scheduler.h"
+#include "../h/exceptions.h"
+#include "../h/initial.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+static mutex_t mutexTable[MAXMUTEX]; /* Semaphores used as mutexes (unused entries have a NULL address) */
+
+/**
+ * Marks every entry of mutexTable unused.
+ * Called once during nucleus initialization.
+ */
+void initMutexes()
+{
+    int i;
+    for (i = 0; i < MAXMUTEX; i++)
+    {
+        mutexTable[i].m_semAdd = NULL;
+        mutexTable[i].m_owner = NULL;
+    }
+}
+
+/**
+ * Returns the mutexTable entry of the semaphore at semAddr. With create set,
+ * an entry is claimed if none exists yet. Returns NULL if there is no entry
+ * (or the table is full).
+ */
+static mutex_t *findMutex(int *semAddr, int create)
+{
+    mutex_t *unused = NULL;
+    int i;
+
+    for (i = 0; i < MAXMUTEX; i++)
+    {
+        if (mutexTable[i].m_semAdd == semAddr)
+            return &mutexTable[i];
+        if (unused == NULL && mutexTable[i].m_semAdd == NULL)
+            unused = &mutexTable[i];
+    }
+
+    if (!create || unused == NULL)
+        return NULL;
+
+    unused->m_semAdd = semAddr;
+    unused->m_owner = NULL;
+    unused->m_acquires = 0;
+    unused->m_holdTotal = 0;
+    unused->m_holdMax = 0;
+    return unused;
+}
+
+/**
+ * Returns the MLFQ level p is entitled to as a waiter.
+ */
+static int waiterPrio(pcb_t *p)
+{
+    return (p->p_period > 0) ? 0 : p->p_prio;
+}
+
+/**
+ * Returns the best MLFQ level among the processes waiting for m,
+ * or NUMPRIOLEVELS if nobody waits.
+ */
+static int bestWaiter(mutex_t *m)
+{
+    int best = NUMPRIOLEVELS;
+    pcb_t *head = headBlocked(m->m_semAdd);
+    pcb_t *p = head;
+
+    if (head == NULL)
+        return best;
+
+    do
+    {
+        best = MIN(best, waiterPrio(p));
+        p = p->p_next;
+    } while (p != head);
+
+    return best;
+}
+
+/**
+ * Raises owner to MLFQ level prio, and so on down the chain of owners of
+ * the mutexes each of them is blocked on.
+ */
+static void inherit(pcb_t *owner, int prio)
+{
+    int hops = 0;
+
+    while (owner != NULL && prio < owner->p_prio && hops++ < MAXMUTEX)
+    {
+        setPrio(owner, OWNPRIO(owner), prio);
+
+        mutex_t *next = (owner->p_semAdd != NULL) ? findMutex(owner->p_semAdd, FALSE) : NULL;
+        owner = (next != NULL) ? next->m_owner : NULL;
+    }
+}
+
+/**
+ * Drops the boost of p down to what the waiters of the mutexes it still
+ * holds require.
+ */
+static void disinherit(pcb_t *p)
+{
+    if (p->p_basePrio < 0)
+        return;
+
+    int inherited = NUMPRIOLEVELS;
+    int i;
+    for (i = 0; i < MAXMUTEX; i++)
+    {
+        if (mutexTable[i].m_semAdd != NULL && mutexTable[i].m_owner == p)
+            inherited = MIN(inherited, bestWaiter(&mutexTable[i]));
+    }
+
+    setPrio(p, p->p_basePrio, inherited);
+}
+
+/**
+ * Called after a waiter left the semaphore at semAddr without getting it
+ * (it timed out or was terminated): if it is a mutex, its owner keeps
+ * only the boost the remaining waiters require, and so on down the chain
+ * of owners of the mutexes each of them is blocked on.
+ */
+void dropWaiter(int *semAddr)
+{
+    int hops = 0;
+    mutex_t *m = findMutex(semAddr, FALSE);
+
+    while (m != NULL && m->m_owner != NULL && hops++ < MAXMUTEX)
+    {
+        pcb_t *owner = m->m_owner;
+        int prio = owner->p_prio;
+
+        disinherit(owner);
+        if (owner->p_prio == prio || owner->p_semAdd == NULL)
+            return;
+
+        m = findMutex(owner->p_semAdd, FALSE);
+    }
+}
+
+/**
+ * Gives m to p (which may be NULL), starting its hold time.
+ */
+static void takeMutex(mutex_t *m, pcb_t *p)
+{
+    m->m_owner = p;
+    if (p != NULL)
+    {
+        STCK(m->m_acquired);
+        m->m_acquires++;
+    }
+}
+
+/**
+ * Ends the hold of m by its owner and passes it to the first waiter,
+ * which inherits the priority of the remaining waiters.
+ */
+static void releaseMutex(mutex_t *m)
+{
+    cpu_t now;
+    STCK(now);
+
+    cpu_t hold = now - m->m_acquired;
+    m->m_holdTotal += hold;
+    m->m_holdMax = MAX(m->m_holdMax, hold);
+
+    pcb_t *woken = sysVerhogen(m->m_semAdd);
+    takeMutex(m, woken);
+
+    if (woken != NULL)
+        inherit(woken, bestWaiter(m));
+}
+
+/**
+ * Locks the mutex at semAddr for the current process. If it is held,
+ * the owner inherits the caller's priority and the caller blocks until
+ * the mutex is handed to it. savedState is the exception state of the caller.
+ * Returns 0 once the mutex is taken without blocking, or -1 (leaving the
+ * semaphore untouched) if mutexTable has no room to track it.
+ */
+int sysMutexP(state_t *savedState, int *semAddr)
+{
+    mutex_t *m = findMutex(semAddr, TRUE);
+
+    /* An untracked mutex could never be released through MUTEXV */
+    if (m == NULL)
+        return -1;
+
+    if (*semAddr <= 0)
+        inherit(m->m_owner, waiterPrio(currentProcess));
+
+    /* Returns only if the mutex was free */
+    sysPasseren(savedState, semAddr);
+    takeMutex(m, currentProcess);
+    return 0;
+}
+
+/**
+ * Unlocks the mutex at semAddr held by the current process and drops the
+ * priority it inherited through it. Returns 0 on success, -1 (leaving the
+ * semaphore untouched) if it was never locked through MUTEXP or the
+ * current process does not own it.
+ */
+int sysMutexV(int *semAddr)
+{
+    mutex_t *m = findMutex(semAddr, FALSE);
+
+    if (m == NULL || m->m_owner != currentProcess)
+        return -1;
+
+    releaseMutex(m);
+    disinherit(currentProcess);
+    return 0;
+}
+
+/**
+ * Adds up the hold statistics of every mutex into stats.
+ */
+void getMutexStats(latstats_t *stats)
+{
+    int i;
+
+    stats->ls_mutexAcquires = 0;
+    stats->ls_mutexHoldTotal = 0;
+    stats->ls_mutexHoldMax = 0;
+
+    for (i = 0; i < MAXMUTEX; i++)
+    {
+        if (mutexTable[i].m_semAdd == NULL)
+            continue;
+
+        stats->ls_mutexAcquires += mutexTable[i].m_acquires;
+        stats->ls_mutexHoldTotal += mutexTable[i].m_holdTotal;
+        stats->ls_mutexHoldMax = MAX(stats->ls_mutexHoldMax, mutexTable[i].m_holdMax);
+    }
+}
+
+/**
+ * Releases every mutex held by p, which is being terminated.
+ */
+void releaseMutexes(pcb_t *p)
+{
+    int i;
+    for (i = 0; i < MAXMUTEX; i++)
+    {
+        if (mutexTable[i].m_semAdd != NULL && mutexTable[i].m_owner == p)
+            releaseMutex(&mutexTable[i]);
+    }
+}
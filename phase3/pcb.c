@@ -6,74 +6,173 @@
  *
  * Implementation Summary:
  * - pcbs are stored in a static array (pcbTable) and managed via a free list (pcbFree_h).
+ *   Once pcbTable is used up, further pcbs come from the slab allocator (pcbSlabs).
+ * - The processor state of each pcb lives in its own save area, outside the pcb:
+ *   stateTable for pcbTable, a stateSlabs object for slab pcbs.
  * - Process queues are circular, doubly linked lists where the tail pointer is updated as needed.
+ *   Each queued pcb records the tail pointer of its queue (p_queue), so removing a given pcb
+ *   is a direct unlink.
  * - Process trees are maintained using parent and sibling pointers for efficient traversal.
  * - Functions for allocation/deallocation and queue/tree manipulation are provided with consistent interfaces.
  ***************************************************************/
 
 #include "../h/pcb.h"
 #include "../h/const.h"
+#include "../h/slab.h"
+#include "../h/klib.h"
  
-static pcb_t pcbTable[MAXPROC]; /* Static array for pcb storage */
-static pcb_t *pcbFree_h = NULL; /* Head of free pcb list */
+static pcb_t pcbTable[MAXPROC];     /* Static array for pcb storage */
+static state_t stateTable[MAXPROC]; /* Processor state save areas of pcbTable */
+static pcb_t *pcbFree_h = NULL;     /* Head of free pcb list */
+
+/* TRUE if the pcb p comes from pcbTable */
+#define STATICPCB(p) ((p) >= &pcbTable[0] && (p) < &pcbTable[MAXPROC])
 
 /**
- * Frees a pcb and inserts it back into the pcbFree list.
+ * Returns a pcb that does not belong to pcbTable, and its save area, to their slabs.
+ */
+static void freeSlabPcb(pcb_t *p)
+{
+    slabFree(p->p_s);
+    slabFree(p);
+}
+
+/**
+ * Frees a pcb and inserts it back into the pcbFree list,
+ * or returns it to its slab if it does not belong to pcbTable.
  */
 void freePcb(pcb_t *p)
 {
     if (p == NULL)
         return;
 
+    if (!STATICPCB(p))
+    {
+        freeSlabPcb(p);
+        return;
+    }
+
     p->p_next = pcbFree_h; /* Insert pcb at the front of the free list */
     pcbFree_h = p;
 }
 
 /**
- * Allocates a pcb from the pcbFree list.
- * Returns a pointer to the pcb or NULL if the list is empty.
+ * Frees a chain of pcbs linked through p_next and ending with NULL.
+ * The pcbs of pcbTable are spliced onto the pcbFree list in one step;
+ * the others go back to their slab.
+ */
+void freePcbs(pcb_t *chain)
+{
+    pcb_t *head = NULL, *tail = NULL;
+
+    while (chain != NULL)
+    {
+        pcb_t *next = chain->p_next;
+
+        if (!STATICPCB(chain))
+        {
+            freeSlabPcb(chain);
+        }
+        else
+        {
+            chain->p_next = head;
+            head = chain;
+            if (tail == NULL)
+                tail = chain;
+        }
+        chain = next;
+    }
+
+    if (head != NULL)
+    {
+        tail->p_next = pcbFree_h; /* Splice the batch in front of the free list */
+        pcbFree_h = head;
+    }
+}
+
+/**
+ * Allocates a pcb from the pcbFree list, or from pcbSlabs once the list is empty.
+ * Returns a pointer to the pcb or NULL if no pcb is available.
  */
 pcb_t *allocPcb()
 {
-    if (pcbFree_h == NULL)
-        return NULL; /* No available pcb */
+    pcb_t *allocated;
 
-    pcb_t *allocated = pcbFree_h;  /* Get the first pcb */
-    pcbFree_h = pcbFree_h->p_next; /* Move head to next pcb */
+    if (pcbFree_h != NULL)
+    {
+        allocated = pcbFree_h;         /* Get the first pcb */
+        pcbFree_h = pcbFree_h->p_next; /* Move head to next pcb */
+    }
+    else
+    {
+        allocated = (pcb_t *)slabAlloc(&pcbSlabs);
+        if (allocated == NULL)
+            return NULL; /* No available pcb */
+
+        allocated->p_s = (state_t *)slabAlloc(&stateSlabs);
+        if (allocated->p_s == NULL)
+        {
+            slabFree(allocated);
+            return NULL; /* No room for its save area */
+        }
+    }
 
     /* Reset all fields */
     allocated->p_next = NULL;
     allocated->p_prev = NULL;
+    allocated->p_queue = NULL;
     allocated->p_prnt = NULL;
     allocated->p_child = NULL;
     allocated->p_sib_left = NULL;
     allocated->p_sib_right = NULL;
     allocated->p_time = 0;
     allocated->p_semAdd = NULL;
+    allocated->p_prio = 0;
+    allocated->p_basePrio = -1;
+    allocated->p_cpu = -1;
+    allocated->p_burst = QUANTUM / 2;
+    allocated->p_burstStart = 0;
+    allocated->p_tickets = DEFAULTSHARE;
+    allocated->p_stride = STRIDE1 / DEFAULTSHARE;
+    allocated->p_pass = 0;
+    allocated->p_period = 0;
+    allocated->p_budget = 0;
+    allocated->p_rtUsed = 0;
+    allocated->p_release = 0;
+    allocated->p_deadline = 0;
+    allocated->p_rtJobs = 0;
+    allocated->p_rtMisses = 0;
+    allocated->p_readyTOD = 0;
+    allocated->p_startTOD = 0;
+    allocated->p_blockTOD = 0;
+    allocated->p_timeout = 0;
+    allocated->p_tmNext = NULL;
+    allocated->p_tmPrev = NULL;
     allocated->p_supportStruct = NULL;
+    allocated->p_pid = -1;
+    allocated->p_dying = FALSE;
 
-    /* Initialize state_t fields */
-    allocated->p_s.s_entryHI = 0;
-    allocated->p_s.s_cause = 0;
-    allocated->p_s.s_status = 0;
-    allocated->p_s.s_pc = 0;
+    memzero(allocated->p_latHist, sizeof(allocated->p_latHist));
+    memzero(allocated->p_acct, sizeof(allocated->p_acct));
 
-    int i;
-    for (i = 0; i < STATEREGNUM; i++)
-    {
-        allocated->p_s.s_reg[i] = 0;
-    }
+    /* Clear the save area, so no register of a previous owner leaks */
+    memzero(allocated->p_s, sizeof(state_t));
 
     return allocated;
 }
 
 /**
- * Initializes the pcbFree list to contain all elements of the static array.
+ * Initializes the pcbFree list to contain all elements of the static array
+ * and binds each of them to its save area in stateTable.
  * Called once during data structure initialization.
  */
 void initPcbs()
 {
     int i;
+    for (i = 0; i < MAXPROC; i++)
+    {
+        pcbTable[i].p_s = &stateTable[i]; /* Bind each pcb to its save area */
+    }
     for (i = 0; i < MAXPROC - 1; i++)
     {
         pcbTable[i].p_next = &pcbTable[i + 1]; /* Link each pcb to the next one */
@@ -99,7 +198,7 @@ int emptyProcQ(pcb_t *tp)
 }
 
 /**
- * Inserts a pcb into the queue pointed to by *tp.
+ * Inserts a pcb into the queue pointed to by *tp and records tp in it.
  * Updates the tail pointer if necessary.
  */
 void insertProcQ(pcb_t **tp, pcb_t *p)
@@ -124,6 +223,7 @@ void insertProcQ(pcb_t **tp, pcb_t *p)
     }
 
     *tp = p; /* Update tail pointer to the new last node */
+    p->p_queue = tp;
 }
 
 /**
@@ -141,47 +241,38 @@ pcb_t *removeProcQ(pcb_t **tp)
 }
 
 /**
- * Removes a specific pcb from the queue.
- * Returns NULL if not found, otherwise returns the pcb.
+ * Removes a specific pcb from the queue. The pcb records the queue it
+ * is on, so it is unlinked directly without searching the queue.
+ * Returns NULL if the pcb is not on this queue, otherwise returns the pcb.
  */
 pcb_t *outProcQ(pcb_t **tp, pcb_t *p)
 {
-    if (*tp == NULL || p == NULL)
-        return NULL; /* Queue is empty or invalid input */
+    if (*tp == NULL || p == NULL || p->p_queue != tp)
+        return NULL; /* Queue is empty, invalid input or pcb not on this queue */
 
-    pcb_t *current = (*tp)->p_next; /* Start from the head */
-
-    do
+    if (p->p_next == p)
     {
-        if (current == p)
-        { /* Found the pcb to remove */
-            if (current == *tp && current->p_next == current)
-            {
-                /* If it's the only element in the queue */
-                *tp = NULL;
-            }
-            else
-            {
-                /* Remove from the list */
-                current->p_prev->p_next = current->p_next;
-                current->p_next->p_prev = current->p_prev;
-
-                if (*tp == current)
-                {
-                    /* Update tail if necessary */
-                    *tp = current->p_prev; 
-                }
-            }
-
-            /* Clear pointers before returning */
-            p->p_next = NULL;
-            p->p_prev = NULL;
-            return p; /* Return the removed pcb */
+        /* If it's the only element in the queue */
+        *tp = NULL;
+    }
+    else
+    {
+        /* Remove from the list */
+        p->p_prev->p_next = p->p_next;
+        p->p_next->p_prev = p->p_prev;
+
+        if (*tp == p)
+        {
+            /* Update tail if necessary */
+            *tp = p->p_prev;
         }
-        current = current->p_next;
-    } while (current != (*tp)->p_next); /* Stop when we loop back to the start */
+    }
 
-    return NULL; /* pcb not found in the queue */
+    /* Clear pointers before returning */
+    p->p_next = NULL;
+    p->p_prev = NULL;
+    p->p_queue = NULL;
+    return p; /* Return the removed pcb */
 }
 
 /**
@@ -194,6 +285,38 @@ pcb_t *headProcQ(pcb_t *tp)
     return tp->p_next;
 }
 
+/**
+ * Appends every pcb of the queue *src, in order, to the tail of the queue
+ * *tp and leaves *src empty. The two circular lists are joined in one
+ * step; only the queue each pcb records is updated one by one.
+ */
+void mergeProcQ(pcb_t **tp, pcb_t **src)
+{
+    if (*src == NULL)
+        return;
+
+    pcb_t *p = (*src)->p_next;
+    do
+    {
+        p->p_queue = tp;
+        p = p->p_next;
+    } while (p != (*src)->p_next);
+
+    if (*tp != NULL)
+    {
+        pcb_t *head = (*tp)->p_next;    /* Head of the destination */
+        pcb_t *srcHead = (*src)->p_next; /* Head of the source */
+
+        (*tp)->p_next = srcHead;
+        srcHead->p_prev = *tp;
+        (*src)->p_next = head;
+        head->p_prev = *src;
+    }
+
+    *tp = *src; /* The source tail is the new tail */
+    *src = NULL;
+}
+
 /**
  *  Return TRUE if the pcb pointed to by p has no children.
  *  Return FALSE otherwise.
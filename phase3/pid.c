@@ -0,0 +1,97 @@
+/************************** pid.c ******************************
+ *
+ * This file implements the process handle table, which gives every process
+ * started by the nucleus a small integer pid.
+ *
+ * Implementation Summary:
+ * - pidTable has MAXPIDS slots; free slots are chained from pidFree_h.
+ * - A pid is the slot index in its low PIDSLOTBITS bits and the generation
+ *   of the slot above them. The generation is bumped every time the slot is
+ *   released, so a stale pid of a terminated process never resolves to the
+ *   process that reuses its slot.
+ * - Issue, lookup and release are constant time.
+ ***************************************************************/
+
+#include "../h/pid.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+/* Slot and generation of a pid */
+#define PIDSLOT(pid) ((pid) & (MAXPIDS - 1))
+#define PIDGEN(pid) (((pid) >> PIDSLOTBITS) & PIDGENMASK)
+
+static pidEntry_t pidTable[MAXPIDS]; /* Process handle table */
+static int pidFree_h;                /* First free slot, -1 if none */
+
+/**
+ * Puts every slot of the handle table on the free list.
+ * Called once during nucleus initialization.
+ */
+void initPids()
+{
+    int i;
+    for (i = 0; i < MAXPIDS; i++)
+    {
+        pidTable[i].h_pcb = NULL;
+        pidTable[i].h_gen = 1;
+        pidTable[i].h_nextFree = i + 1;
+    }
+    pidTable[MAXPIDS - 1].h_nextFree = -1;
+    pidFree_h = 0;
+}
+
+/**
+ * Gives p a pid. Returns the pid, or -1 if the handle table is full.
+ */
+int allocPid(pcb_t *p)
+{
+    if (pidFree_h < 0)
+        return -1;
+
+    int slot = pidFree_h;
+    pidFree_h = pidTable[slot].h_nextFree;
+
+    pidTable[slot].h_pcb = p;
+    p->p_pid = (pidTable[slot].h_gen << PIDSLOTBITS) | slot;
+
+    return p->p_pid;
+}
+
+/**
+ * Releases the pid of p, which is being terminated.
+ */
+void freePid(pcb_t *p)
+{
+    if (p->p_pid < 0)
+        return;
+
+    int slot = PIDSLOT(p->p_pid);
+
+    /* Retire the generation; 0 is skipped so that no pid is ever 0 */
+    pidTable[slot].h_gen = (pidTable[slot].h_gen + 1) & PIDGENMASK;
+    if (pidTable[slot].h_gen == 0)
+        pidTable[slot].h_gen = 1;
+
+    pidTable[slot].h_pcb = NULL;
+    pidTable[slot].h_nextFree = pidFree_h;
+    pidFree_h = slot;
+
+    p->p_pid = -1;
+}
+
+/**
+ * Returns the live process with the given pid, or NULL if the pid is
+ * invalid or its process has terminated.
+ */
+pcb_t *pidLookup(int pid)
+{
+    if (pid <= 0)
+        return NULL;
+
+    pidEntry_t *entry = &pidTable[PIDSLOT(pid)];
+
+    if (entry->h_pcb == NULL || entry->h_gen != PIDGEN(pid))
+        return NULL;
+
+    return entry->h_pcb;
+}
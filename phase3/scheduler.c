@@ -1,11 +1,38 @@
 /************************** scheduler.c ******************************
  *
  * This file implements the scheduler, which selects and dispatches the next
- * process to run from the ready queue. It ensures fair execution by setting
- * a time slice using the Process Local Timer (PLT). If no process is ready,
- * it handles cases such as waiting for I/O, detecting deadlock, or halting
- * the system when no processes remain. The scheduler is a key component of
- * process management, ensuring efficient multitasking and system stability.
+ * process to run from the ready queues. Ready processes are kept in a
+ * multi-level feedback queue (MLFQ): one FIFO queue per priority level, with
+ * level 0 being the highest priority. A process that uses up its whole time
+ * slice drops one level, a process that blocks rises one level, and a periodic
+ * aging pass, run at dispatch time every AGINGPERIOD, lifts every waiting
+ * process one level so that CPU-bound processes cannot starve. Every CPU owns one set of MLFQ queues; a process is queued on
+ * the CPU it last ran on, and a CPU with nothing to run steals the best ready
+ * process of the most loaded CPU. The time slice is enforced using the
+ * Process Local Timer (PLT) and adapts to each process: it is twice the
+ * running average of its past CPU bursts, bounded by MINQUANTUM and
+ * MAXQUANTUM, and cut down to MINQUANTUM while latency-sensitive (short
+ * burst) processes are waiting. Within one MLFQ level, processes share the CPU
+ * in proportion to their tickets (stride scheduling): each one advances its
+ * pass value by its stride for every time slice worth of CPU it uses, and the
+ * lowest pass runs first. A process whose time slice ends while nothing else
+ * is ready on its CPU is resumed in place (resumeIfAlone), without a trip
+ * through the ready queues; fastPathHits counts how often that happens.
+ * A process doing a V can also hand the rest of its time slice straight to
+ * the process it woke (handOff), which then skips the ready queue.
+ * Every ready queue wait, from makeReady() to dispatch, is recorded in a log2
+ * latency histogram of the process and in the global latencyHist.
+ *
+ * Real-time processes registered with a period and a budget form a separate
+ * earliest-deadline-first (EDF) class dispatched ahead of every MLFQ level.
+ * Admission control keeps the sum of budget/period under RTMAXLOAD. A job
+ * that overruns its budget falls back to the MLFQ until it completes, and a
+ * process waiting for its next release sleeps on rtSleepQ, checked at each
+ * dispatch and whenever the interval timer fires; the interval timer is
+ * always armed for the earliest sleeping release. If no process is ready, it
+ * handles cases such as waiting for I/O (the CPU sleeps until the next device
+ * or timer interrupt), detecting deadlock, or halting the system when no
+ * processes remain.
  ***************************************************************/
 
 #include "../h/scheduler.h"
@@ -16,15 +43,592 @@
 #include "../h/interrupts.h"
 #include "../h/types.h"
 #include "../h/const.h"
+#include "../h/smp.h"
+#include "../h/klib.h"
+
+static cpu_t lastAging = 0;         /* TOD of the last aging pass */
+static unsigned int globalPass = 0; /* Pass value of the latest dispatched process */
+
+static pcb_t *rtReadyQ = NULL;        /* Real-time processes with a released job */
+static pcb_t *rtSleepQ = NULL;        /* Real-time processes waiting for their next release */
+static int rtLoad = 0;               /* Per-mille of the CPU reserved by real-time processes */
+
+int fastPathHits = 0; /* Times the running process was resumed in place */
+int latencyHist[LATBUCKETS]; /* Log2 histogram of every ready queue wait */
+int rtJobs = 0;   /* Real-time jobs completed */
+int rtMisses = 0; /* Real-time jobs completed after their deadline */
+
+/* TRUE if pass value a is behind pass value b (wrap-around safe) */
+#define PASSBEFORE(a, b) ((int)((a) - (b)) < 0)
+
+/* TRUE if p currently runs in the real-time class */
+#define REALTIME(p) ((p)->p_period > 0 && (p)->p_rtUsed < (p)->p_budget)
+
+/**
+ * Returns the CPU with the fewest ready processes.
+ */
+static int leastLoadedCPU()
+{
+    int cpu, best = 0;
+    for (cpu = 1; cpu < NCPU; cpu++)
+    {
+        if (readyCount[cpu] < readyCount[best])
+            best = cpu;
+    }
+    return best;
+}
+
+/**
+ * Inserts a process at the tail of the ready queue matching its MLFQ level,
+ * on the CPU it last ran on. Processes that never ran go to the least
+ * loaded CPU.
+ */
+void makeReady(pcb_t *p)
+{
+    if (p == NULL)
+        return;
+
+    STCK(p->p_readyTOD);
+
+    /* Woken before its timed P expired */
+    cancelTimeout(p);
+
+    /* Close the time it spent blocked, if it was */
+    if (p->p_blockTOD != 0)
+    {
+        p->p_acct[ACCTBLOCKED] += p->p_readyTOD - p->p_blockTOD;
+        p->p_blockTOD = 0;
+    }
+
+    if (REALTIME(p))
+    {
+        insertProcQ(&rtReadyQ, p);
+        return;
+    }
+
+    if (p->p_cpu < 0)
+        p->p_cpu = leastLoadedCPU();
+
+    /* A process that slept or is new must not catch up on the time it missed */
+    if (PASSBEFORE(p->p_pass, globalPass))
+        p->p_pass = globalPass;
+
+    insertProcQ(&readyQueues[p->p_cpu][p->p_prio], p);
+    readyCount[p->p_cpu]++;
+    if (p->p_burst < SHORTBURST)
+        shortReadyCount[p->p_cpu]++;
+}
+
+/**
+ * Updates the ready counters of cpu after p left its ready queues.
+ */
+static void uncountReady(int cpu, pcb_t *p)
+{
+    readyCount[cpu]--;
+    if (p->p_burst < SHORTBURST)
+        shortReadyCount[cpu]--;
+}
+
+/**
+ * Removes a specific process from the ready queue it is waiting on.
+ * Returns NULL if the process is not ready, otherwise returns the pcb.
+ */
+pcb_t *outReady(pcb_t *p)
+{
+    if (p == NULL)
+        return NULL;
+
+    if (REALTIME(p))
+        return outProcQ(&rtReadyQ, p);
+
+    if (p->p_cpu < 0)
+        return NULL;
+
+    pcb_t *removed = outProcQ(&readyQueues[p->p_cpu][p->p_prio], p);
+    if (removed != NULL)
+        uncountReady(p->p_cpu, removed);
+
+    return removed;
+}
+
+/**
+ * Returns TRUE if some process ready on the executing CPU sits on a
+ * strictly higher priority level than prio, FALSE otherwise.
+ */
+static int readyAbove(int prio)
+{
+    int cpu = getPRID();
+    int level;
+    for (level = 0; level < prio; level++)
+    {
+        if (!emptyProcQ(readyQueues[cpu][level]))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Returns the real-time process with the earliest deadline in the queue
+ * with tail tp.
+ */
+static pcb_t *earliestDeadline(pcb_t *tp)
+{
+    pcb_t *best = headProcQ(tp);
+    pcb_t *p = best->p_next;
+
+    while (p != tp->p_next)
+    {
+        if (p->p_deadline < best->p_deadline)
+            best = p;
+        p = p->p_next;
+    }
+    return best;
+}
+
+/**
+ * Returns TRUE if a ready process should take the CPU away from p, FALSE otherwise.
+ */
+int outranked(pcb_t *p)
+{
+    if (!emptyProcQ(rtReadyQ))
+    {
+        if (!REALTIME(p))
+            return TRUE;
+        if (earliestDeadline(rtReadyQ)->p_deadline < p->p_deadline)
+            return TRUE;
+        return FALSE;
+    }
+
+    return !REALTIME(p) && readyAbove(p->p_prio);
+}
+
+/**
+ * Moves every real-time process whose next job is due from rtSleepQ
+ * to the ready queues.
+ */
+void releaseJobs()
+{
+    if (emptyProcQ(rtSleepQ))
+        return;
+
+    cpu_t now;
+    STCK(now);
+
+    pcb_t *p = headProcQ(rtSleepQ);
+    while (p != NULL)
+    {
+        pcb_t *next = (p == rtSleepQ) ? NULL : p->p_next;
+
+        if (p->p_release <= now)
+        {
+            outProcQ(&rtSleepQ, p);
+            softBlockCount--;
+            makeReady(p);
+        }
+        p = next;
+    }
+}
+
+/**
+ * Returns the TOD of the next release on rtSleepQ,
+ * or -1 if no real-time process is sleeping.
+ */
+cpu_t nextRelease()
+{
+    if (emptyProcQ(rtSleepQ))
+        return -1;
+
+    cpu_t first = headProcQ(rtSleepQ)->p_release;
+    pcb_t *p = headProcQ(rtSleepQ)->p_next;
+    while (p != rtSleepQ->p_next)
+    {
+        first = MIN(first, p->p_release);
+        p = p->p_next;
+    }
+    return first;
+}
+
+/**
+ * Admits p into the real-time class with the given period and budget
+ * (both in microseconds, the period at most MAXINT / 1000), its first job
+ * being released right away. A zero period moves p back to the best-effort class.
+ * Returns 0 on success, -1 if the parameters are invalid or the
+ * reservation would push the real-time load above RTMAXLOAD.
+ */
+int setRealtime(pcb_t *p, cpu_t period, cpu_t budget)
+{
+    int load = 0;
+
+    if (period != 0)
+    {
+        if (period < 0 || period > MAXINT / 1000 || budget <= 0 || budget > period)
+            return -1;
+        load = (budget * 1000) / period;
+    }
+
+    int oldLoad = (p->p_period > 0) ? (p->p_budget * 1000) / p->p_period : 0;
+
+    if (rtLoad - oldLoad + load > RTMAXLOAD)
+        return -1; /* Admission control */
+
+    rtLoad += load - oldLoad;
+
+    p->p_period = period;
+    p->p_budget = budget;
+    p->p_rtUsed = 0;
+    STCK(p->p_release);
+    p->p_deadline = p->p_release + period;
+
+    return 0;
+}
+
+/**
+ * Ends the current job of the real-time process p. Records whether the job
+ * met its deadline and, unless the next job is already due, puts p to sleep
+ * on rtSleepQ. Returns TRUE if p went to sleep, FALSE otherwise.
+ */
+int completeJob(pcb_t *p)
+{
+    cpu_t now;
+    STCK(now);
+
+    p->p_rtJobs++;
+    rtJobs++;
+    if (now > p->p_deadline)
+    {
+        p->p_rtMisses++;
+        rtMisses++;
+    }
+
+    /* Next job */
+    p->p_rtUsed = 0;
+    p->p_release += p->p_period;
+    p->p_deadline = p->p_release + p->p_period;
+
+    if (p->p_release <= now)
+        return FALSE;
+
+    insertProcQ(&rtSleepQ, p);
+    softBlockCount++;
+    armIntervalTimer(p->p_release);
+    return TRUE;
+}
+
+/**
+ * Removes p from the real-time class when it is terminated, releasing
+ * its reservation and waking it off rtSleepQ if it was sleeping there.
+ */
+void dropRealtime(pcb_t *p)
+{
+    if (p->p_period == 0)
+        return;
+
+    if (outProcQ(&rtSleepQ, p) != NULL)
+        softBlockCount--;
+
+    rtLoad -= (p->p_budget * 1000) / p->p_period;
+    p->p_period = 0;
+}
+
+/**
+ * Sets the CPU share of p, clamped to 1..MAXSHARE.
+ * Returns the share p held before.
+ */
+int setShare(pcb_t *p, int tickets)
+{
+    int old = p->p_tickets;
+
+    p->p_tickets = MAX(1, MIN(tickets, MAXSHARE));
+    p->p_stride = STRIDE1 / p->p_tickets;
+
+    return old;
+}
+
+/**
+ * Sets the MLFQ level of p from the level it earned on its own (own) and
+ * the level it inherited through the mutexes it holds (inherited, or
+ * NUMPRIOLEVELS if none): p runs at the better of the two, and keeps own
+ * in p_basePrio while the inherited level is better. A ready p moves to
+ * the ready queue of its new level.
+ */
+void setPrio(pcb_t *p, int own, int inherited)
+{
+    int ready = !REALTIME(p) && p->p_cpu >= 0 && outProcQ(&readyQueues[p->p_cpu][p->p_prio], p) != NULL;
+
+    p->p_prio = MIN(own, inherited);
+    p->p_basePrio = (inherited < own) ? own : -1;
+
+    if (ready)
+        insertProcQ(&readyQueues[p->p_cpu][p->p_prio], p);
+}
+
+/**
+ * Moves a process one level down after it consumed its whole time slice.
+ * A boosted process keeps its inherited level.
+ */
+void demote(pcb_t *p)
+{
+    setPrio(p, MIN(OWNPRIO(p) + 1, NUMPRIOLEVELS - 1), INHERITEDPRIO(p));
+}
+
+/**
+ * Moves a process one level up when it gives up the CPU by blocking.
+ */
+void promote(pcb_t *p)
+{
+    setPrio(p, MAX(OWNPRIO(p) - 1, 0), INHERITEDPRIO(p));
+}
+
+/**
+ * Closes the current CPU burst of p and folds its length into the
+ * running average used to size the next time slice.
+ */
+void endBurst(pcb_t *p)
+{
+    cpu_t now;
+    STCK(now);
+
+    cpu_t burst = now - p->p_burstStart;
+
+    p->p_burst = (p->p_burst + burst) / 2;
+    p->p_burstStart = now;
+
+    /* Charge the stride for the fraction of a default time slice used,
+       whole slices first so the product cannot wrap for long bursts */
+    p->p_pass += p->p_stride * ((unsigned int)burst / QUANTUM) +
+                 (p->p_stride * ((unsigned int)burst % QUANTUM)) / QUANTUM;
+
+    /* Charge the real-time budget of the current job */
+    if (p->p_period > 0)
+        p->p_rtUsed += burst;
+}
+
+/**
+ * Returns the time slice for p when dispatched on cpu.
+ */
+static cpu_t pickQuantum(pcb_t *p, int cpu)
+{
+    /* A real-time job runs until it completes or its budget runs out */
+    if (REALTIME(p))
+        return MIN(p->p_budget - p->p_rtUsed, MAXQUANTUM);
+
+    cpu_t quantum = 2 * p->p_burst;
+
+    /* Keep the CPU turning over while latency-sensitive processes wait */
+    if (shortReadyCount[cpu] > 0)
+        quantum = MIN(quantum, MINQUANTUM);
+
+    return MAX(MINQUANTUM, MIN(quantum, MAXQUANTUM));
+}
+
+/**
+ * Called at every dispatch. Every AGINGPERIOD microseconds, every ready
+ * process below level 0 is moved one level up, so processes that keep
+ * losing to interactive ones eventually get to run; a boosted process
+ * may stay on its inherited level. Aging only matters
+ * while processes compete for a CPU, and then dispatches happen at least
+ * every MAXQUANTUM, so it needs no clock tick of its own.
+ */
+static void ageReadyQueues()
+{
+    cpu_t now;
+    STCK(now);
+
+    if (now - lastAging < AGINGPERIOD)
+        return;
+
+    lastAging = now;
+
+    int cpu, level;
+    for (cpu = 0; cpu < NCPU; cpu++)
+    {
+        for (level = 1; level < NUMPRIOLEVELS; level++)
+        {
+            /* Empty the level first: a boosted process may go back to it */
+            pcb_t *aged = mkEmptyProcQ();
+            pcb_t *p;
+            while ((p = removeProcQ(&readyQueues[cpu][level])) != NULL)
+                insertProcQ(&aged, p);
+
+            while ((p = removeProcQ(&aged)) != NULL)
+            {
+                setPrio(p, MAX(OWNPRIO(p) - 1, 0), INHERITEDPRIO(p));
+                insertProcQ(&readyQueues[cpu][p->p_prio], p);
+            }
+        }
+    }
+}
+
+/**
+ * Fast path for a process whose time slice ran out: if no other process is
+ * ready on this CPU, p gets a new time slice and resumes straight from the
+ * saved exception state, skipping the copy of its state into the pcb, the
+ * ready queue round trip and the scheduler. The caller must have closed the
+ * burst of p already. Returns only if some other process is ready.
+ */
+void resumeIfAlone(pcb_t *p)
+{
+    int cpu = getPRID();
+
+    releaseJobs();
+
+    if (!emptyProcQ(rtReadyQ) || readyCount[cpu] > 0)
+        return;
+
+    fastPathHits++;
+
+    /* Drop TLB entries a pager invalidated since this CPU entered the nucleus */
+    syncTLB();
+    setTIMER(pickQuantum(p, cpu));
+    releaseLock(&globalLock);
+    LDST(EXCSTATE(cpu));
+}
+
+/**
+ * Records in the histograms that p waited from p_readyTOD to now in the ready queues.
+ */
+static void recordLatency(pcb_t *p, cpu_t now)
+{
+    unsigned int wait = (unsigned int)(now - p->p_readyTOD);
+    int bucket = 0;
+
+    while ((wait >>= 1) != 0 && bucket < LATBUCKETS - 1)
+        bucket++;
+
+    p->p_latHist[bucket]++;
+    latencyHist[bucket]++;
+}
+
+/**
+ * Copies the latency histogram of p and the global one into stats.
+ */
+void getLatency(pcb_t *p, latstats_t *stats)
+{
+    memcopy(stats->ls_proc, p->p_latHist, sizeof(stats->ls_proc));
+    memcopy(stats->ls_global, latencyHist, sizeof(stats->ls_global));
+}
+
+/**
+ * Returns the process with the lowest pass value in the queue with tail tp.
+ * Ties go to the process closest to the head.
+ */
+static pcb_t *lowestPass(pcb_t *tp)
+{
+    pcb_t *best = headProcQ(tp);
+    pcb_t *p = best->p_next;
+
+    while (p != tp->p_next)
+    {
+        if (PASSBEFORE(p->p_pass, best->p_pass))
+            best = p;
+        p = p->p_next;
+    }
+    return best;
+}
+
+/**
+ * Removes and returns the lowest pass process of the highest priority
+ * non-empty ready queue of the given CPU. Returns NULL if no process is
+ * ready there.
+ */
+static pcb_t *removeReady(int cpu)
+{
+    int level;
+    for (level = 0; level < NUMPRIOLEVELS; level++)
+    {
+        if (!emptyProcQ(readyQueues[cpu][level]))
+        {
+            pcb_t *p = outProcQ(&readyQueues[cpu][level], lowestPass(readyQueues[cpu][level]));
+            uncountReady(cpu, p);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Takes the best ready process of the most loaded CPU and moves it to cpu.
+ * Returns NULL if no CPU has a process ready.
+ */
+static pcb_t *stealReady(int cpu)
+{
+    int victim, busiest = -1;
+    for (victim = 0; victim < NCPU; victim++)
+    {
+        if (victim != cpu && readyCount[victim] > 0 &&
+            (busiest < 0 || readyCount[victim] > readyCount[busiest]))
+            busiest = victim;
+    }
+
+    if (busiest < 0)
+        return NULL;
+
+    pcb_t *p = removeReady(busiest);
+    p->p_cpu = cpu;
+    return p;
+}
+
+/**
+ * Makes next the current process of the executing CPU and runs it for the
+ * given time slice. Must be called with globalLock held; never returns.
+ */
+static void dispatch(pcb_t *next, cpu_t quantum)
+{
+    int cpu = getPRID();
+
+    currentProcess = next;
+    next->p_cpu = cpu;
+
+    if (PASSBEFORE(globalPass, next->p_pass))
+        globalPass = next->p_pass;
+
+    /* Drop stale translations left behind by page evictions */
+    syncTLB();
+
+    /* Load the Process Local Timer (PLT) with the time slice */
+    setTIMER(quantum);
+    STCK(next->p_burstStart);
+    next->p_startTOD = next->p_burstStart;
+    recordLatency(next, next->p_burstStart);
+
+    /* Load the process state and execute */
+    releaseLock(&globalLock);
+    LDST(next->p_s);
+}
+
+/**
+ * Runs the ready process p right away on the executing CPU for the rest of
+ * the time slice of the current process, which must already be saved and
+ * back on the ready queues (directed yield). Never returns.
+ */
+void handOff(pcb_t *p)
+{
+    cpu_t left = (cpu_t)getTIMER();
+
+    outReady(p);
+    dispatch(p, MAX(left, MINQUANTUM));
+}
 
 /**
  * The scheduler selects the next process to run and dispatches it.
  * If no process is ready, it handles termination, waiting, or deadlock scenarios.
+ * Must be called with globalLock held; the lock is released before leaving the nucleus.
  */
 void scheduler()
 {
-    /* Select the next process to run */
-    currentProcess = removeProcQ(&readyQueue);
+    int cpu = getPRID();
+
+    releaseJobs();
+    ageReadyQueues();
+
+    /* Select the next process to run: real-time jobs first, then this
+       CPU's MLFQ, then work stolen from another CPU */
+    if (!emptyProcQ(rtReadyQ))
+        currentProcess = outProcQ(&rtReadyQ, earliestDeadline(rtReadyQ));
+    else
+        currentProcess = removeReady(cpu);
+    if (currentProcess == NULL)
+        currentProcess = stealReady(cpu);
 
     /* If no ready process exists, handle special cases */
     if (currentProcess == NULL)
@@ -33,10 +637,22 @@ void scheduler()
         {
             HALT(); /* No active processes, system halts */
         }
-        else if (softBlockCount > 0)
+        else if (softBlockCount > 0 || busyCPUs() > 0)
         {
-            /* Wait for an I/O or timer interrupt */
-            setSTATUS(((IECON | IM) & TIMEROFF) & ~TEBITON);
+            releaseLock(&globalLock);
+
+            if (NCPU > 1)
+            {
+                /* Wake up periodically to look for work to steal */
+                setTIMER(IDLEPOLL);
+                setSTATUS(IECON | IM | TEBITON);
+            }
+            else
+            {
+                /* Sleep until the next I/O completion or timed event; the
+                   interval timer is only armed while one is pending */
+                setSTATUS(((IECON | IM) & TIMEROFF) & ~TEBITON);
+            }
             WAIT();
         }
         else
@@ -45,9 +661,5 @@ void scheduler()
         }
     }
 
-    /* Load the Process Local Timer (PLT) with 5 milliseconds */
-    setTIMER(5000);
-
-    /* Load the process state and execute */
-    LDST(&(currentProcess->p_s));
-}
\ No newline at end of file
+    dispatch(currentProcess, pickQuantum(currentProcess, cpu));
+}
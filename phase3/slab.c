@@ -0,0 +1,193 @@
+/************************** slab.c ******************************
+ *
+ * This file implements the slab allocator the nucleus falls back on once
+ * the static pcb and semaphore descriptor tables are used up.
+ *
+ * Implementation Summary:
+ * - The RAM frames between the swap pool and the lowest handler stack
+ *   (SLABSTART to SLABEND) are handed out on demand: first from the list of
+ *   frames given back, then by moving nextFrame up.
+ * - A slab is one frame: a slab_t header followed by as many objects of its
+ *   cache as fit. Free objects are chained through their first word, and
+ *   the header of any object is found by rounding its address down to the
+ *   frame, so freeing is constant time.
+ * - Slabs whose objects are all free stay with their cache until a frame is
+ *   needed and none is left; then every fully free slab of every cache is
+ *   given back before trying again.
+ ***************************************************************/
+
+#include "../h/slab.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+/* Slab holding the object at address obj */
+#define SLABOF(obj) ((slab_t *)((memaddr)(obj) & ~(PAGESIZE - 1)))
+
+slabcache_t pcbSlabs;  /* Slabs of pcbs */
+slabcache_t semdSlabs; /* Slabs of semaphore descriptors */
+slabcache_t stateSlabs; /* Slabs of processor state save areas */
+
+static memaddr frameFree_h; /* Frames given back (each links the next), 0 if none */
+static memaddr nextFrame;   /* First frame never handed out */
+static memaddr endFrame;    /* End of the slab frames */
+
+/**
+ * Sets up an empty cache for objects of the given size.
+ */
+static void initCache(slabcache_t *cache, int objSize)
+{
+    cache->sc_objSize = objSize;
+    cache->sc_slabs = NULL;
+    cache->sc_slabCount = 0;
+}
+
+/**
+ * Sets up the pcb, semd and save area caches and the frames slabs are carved from.
+ * Called once during nucleus initialization.
+ */
+void initSlabs()
+{
+    initCache(&pcbSlabs, sizeof(pcb_t));
+    initCache(&semdSlabs, sizeof(semd_t));
+    initCache(&stateSlabs, sizeof(state_t));
+
+    frameFree_h = 0;
+    nextFrame = SLABSTART;
+    endFrame = SLABEND;
+}
+
+/**
+ * Returns a free frame, or 0 if none is left.
+ */
+static memaddr getFrame()
+{
+    memaddr frame = frameFree_h;
+
+    if (frame != 0)
+    {
+        frameFree_h = *((memaddr *)frame);
+    }
+    else if (nextFrame + PAGESIZE <= endFrame)
+    {
+        frame = nextFrame;
+        nextFrame += PAGESIZE;
+    }
+
+    return frame;
+}
+
+/**
+ * Gives every fully free slab of cache back to the frame list.
+ */
+static void reclaimCache(slabcache_t *cache)
+{
+    slab_t **link = &cache->sc_slabs;
+
+    while (*link != NULL)
+    {
+        slab_t *slab = *link;
+        if (slab->sl_inUse == 0)
+        {
+            *link = slab->sl_next;
+            cache->sc_slabCount--;
+
+            *((memaddr *)slab) = frameFree_h;
+            frameFree_h = (memaddr)slab;
+        }
+        else
+        {
+            link = &slab->sl_next;
+        }
+    }
+}
+
+/**
+ * Carves a new slab for cache out of a free frame, reclaiming the fully
+ * free slabs of every cache if no frame is left.
+ * Returns NULL if no frame can be found.
+ */
+static slab_t *newSlab(slabcache_t *cache)
+{
+    memaddr frame = getFrame();
+
+    if (frame == 0)
+    {
+        /* Memory pressure: give back the slabs nobody uses */
+        reclaimCache(&pcbSlabs);
+        reclaimCache(&semdSlabs);
+        reclaimCache(&stateSlabs);
+        frame = getFrame();
+        if (frame == 0)
+            return NULL;
+    }
+
+    slab_t *slab = (slab_t *)frame;
+    slab->sl_cache = cache;
+    slab->sl_inUse = 0;
+    slab->sl_free = NULL;
+
+    /* Chain every object of the frame on the free list, lowest address first */
+    memaddr obj = frame + PAGESIZE - cache->sc_objSize;
+    while (obj >= frame + sizeof(slab_t))
+    {
+        *((void **)obj) = slab->sl_free;
+        slab->sl_free = (void *)obj;
+        obj -= cache->sc_objSize;
+    }
+
+    slab->sl_next = cache->sc_slabs;
+    cache->sc_slabs = slab;
+    cache->sc_slabCount++;
+
+    return slab;
+}
+
+/**
+ * Returns a free object of cache, carving a new slab if every slab is full.
+ * Returns NULL if there is no memory left for one.
+ */
+void *slabAlloc(slabcache_t *cache)
+{
+    slab_t *slab = cache->sc_slabs;
+
+    while (slab != NULL && slab->sl_free == NULL)
+    {
+        slab = slab->sl_next;
+    }
+
+    if (slab == NULL)
+        slab = newSlab(cache);
+    if (slab == NULL)
+        return NULL;
+
+    void *obj = slab->sl_free;
+    slab->sl_free = *((void **)obj);
+    slab->sl_inUse++;
+
+    return obj;
+}
+
+/**
+ * Returns an object obtained from slabAlloc() to its slab.
+ */
+void slabFree(void *obj)
+{
+    slab_t *slab = SLABOF(obj);
+
+    *((void **)obj) = slab->sl_free;
+    slab->sl_free = obj;
+    slab->sl_inUse--;
+}
+
+/**
+ * Returns TRUE if obj lies in a slab of cache, FALSE otherwise.
+ */
+int slabOwns(slabcache_t *cache, void *obj)
+{
+    memaddr addr = (memaddr)obj;
+
+    if (addr < SLABSTART || addr >= nextFrame)
+        return FALSE;
+
+    return SLABOF(obj)->sl_cache == cache;
+}
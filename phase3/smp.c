@@ -0,0 +1,155 @@
+/************************** smp.c ******************************
+ *
+ * This file implements the multiprocessor support of the nucleus.
+ * uMPS3 can emulate up to 16 processors sharing one RAM; NCPU in const.h
+ * selects how many of them the nucleus drives.
+ *
+ * Implementation Summary:
+ * - All nucleus data (pcbs, ASL, ready queues, device semaphores and the
+ *   process counters) is guarded by globalLock, a CAS-based spinlock taken
+ *   on every nucleus entry and released right before control leaves the
+ *   nucleus (LDST, LDCXT or WAIT). Nucleus paths freely combine ASL,
+ *   ready queue and counter updates, so one lock keeps them consistent
+ *   without any lock ordering rules; U-procs only contend on it when they
+ *   trap, so CPU-bound work still runs in parallel.
+ * - Each CPU has its own current process, BIOS exception state, nucleus
+ *   stack and MLFQ ready queues (see scheduler.c).
+ * - Secondary CPUs are started by bootSecondaryCPUs() in cpuStart(), which
+ *   simply enters the scheduler.
+ * - TLB shootdown: uMPS3 has no way to clear the TLB of another CPU, so
+ *   the pager bumps tlbEpoch through tlbShootdown() and every CPU flushes
+ *   its own TLB on its next nucleus entry or dispatch after the epoch
+ *   changed. tlbShootdown() returns only once every CPU running a process
+ *   has flushed (the PLT bounds the wait to one time slice), so the
+ *   evicted frame is never reused while a stale mapping to it survives.
+ ***************************************************************/
+
+#include "../h/smp.h"
+#include "../h/initial.h"
+#include "../h/scheduler.h"
+#include "../h/klib.h"
+#include "../h/types.h"
+#include "../h/const.h"
+
+unsigned int globalLock = 0; /* Nucleus lock: 0 free, 1 held */
+int tlbEpoch = 0;            /* Bumped whenever a page table entry is invalidated */
+
+static int cpuTlbEpoch[NCPU]; /* Last tlbEpoch each CPU flushed its TLB for */
+
+/**
+ * Spins until the lock is taken by the executing CPU.
+ */
+void acquireLock(unsigned int *lock)
+{
+    while (!CAS(lock, 0, 1))
+        ;
+}
+
+/**
+ * Releases a lock held by the executing CPU.
+ */
+void releaseLock(unsigned int *lock)
+{
+    *lock = 0;
+}
+
+/**
+ * Starts every secondary CPU in cpuStart() in kernel mode with interrupts
+ * disabled, on its own nucleus stack. Called once by CPU 0 at the end of
+ * the nucleus initialization, while it holds globalLock.
+ */
+void bootSecondaryCPUs()
+{
+    int cpu;
+    state_t startState;
+
+    for (cpu = 1; cpu < NCPU; cpu++)
+    {
+        memzero(&startState, sizeof(state_t));
+
+        startState.s_status = ALLOFF | TEBITON;
+        startState.s_pc = (memaddr)cpuStart;
+        startState.s_t9 = (memaddr)cpuStart;
+        startState.s_sp = CPUSTACK(cpu);
+
+        INITCPU(cpu, &startState);
+    }
+}
+
+/**
+ * Entry point of a secondary CPU: joins the nucleus and picks a process.
+ */
+void cpuStart()
+{
+    acquireLock(&globalLock);
+    scheduler();
+}
+
+/**
+ * Returns the number of CPUs currently running a process.
+ */
+int busyCPUs()
+{
+    int cpu, busy = 0;
+    for (cpu = 0; cpu < NCPU; cpu++)
+    {
+        if (currentProcs[cpu] != NULL)
+            busy++;
+    }
+    return busy;
+}
+
+/**
+ * Flushes the TLB of the executing CPU if some page table entry was
+ * invalidated since its last flush. Called on every nucleus entry and
+ * at every dispatch, with globalLock held.
+ */
+void syncTLB()
+{
+    int cpu = getPRID();
+
+    if (cpuTlbEpoch[cpu] != tlbEpoch)
+    {
+        TLBCLR();
+        cpuTlbEpoch[cpu] = tlbEpoch;
+    }
+}
+
+/**
+ * Makes every CPU drop the TLB entries of a page table entry the caller
+ * just invalidated: bumps tlbEpoch, flushes the local TLB and waits until
+ * every other CPU running a process has flushed its own. An idle CPU
+ * flushes when it next dispatches, so it is not waited for.
+ * Called by the pager, outside the nucleus.
+ */
+void tlbShootdown()
+{
+    unsigned int status = getSTATUS();
+    int cpu, self, epoch, pending;
+
+    /* A PLT interrupt must not enter the nucleus while this CPU holds
+       globalLock, and the process must not move to another CPU */
+    setSTATUS(status & ~IECON);
+    acquireLock(&globalLock);
+
+    self = getPRID();
+    epoch = ++tlbEpoch;
+    syncTLB();
+
+    do
+    {
+        pending = FALSE;
+        for (cpu = 0; cpu < NCPU; cpu++)
+        {
+            if (cpu != self && currentProcs[cpu] != NULL && cpuTlbEpoch[cpu] - epoch < 0)
+                pending = TRUE;
+        }
+
+        /* Let the other CPUs into the nucleus to flush */
+        releaseLock(&globalLock);
+        if (pending)
+            acquireLock(&globalLock);
+    } while (pending);
+
+    setSTATUS(status);
+}
@@ -2,11 +2,13 @@
  *
  * WRITTEN BY HARIS AND ANNIE
  *
- * This file handles system calls 9 through 13, which are invoked when an exception
+ * This file handles system calls 9 through 13 and 21 through 24, which are invoked when an exception
  * is passed up from a user process to its support-level exception handler. These syscalls
  * include Terminate (SYS9), getTOD (SYS10), writeToPrinter (SYS11), writeToTerminal (SYS12),
- * and readFromTerminal (SYS13). Each of these is implemented at the process level and runs
- * in the context of the user process’s support structure. This file ensures safe and
+ * readFromTerminal (SYS13), setShare (SYS21), setPeriodic (SYS22), waitPeriod (SYS23) and
+ * getLatency (SYS24).
+ * Each of these is implemented at the process level and runs in the context of the user
+ * process’s support structure. This file ensures safe and
  * validated interaction between user memory and I/O devices, using local buffers,
  * uMPS3 I/O protocols, and mutual exclusion via semaphores to prevent race conditions.
  * Any invalid arguments, device errors, or unhandled cases result in the orderly
@@ -25,6 +27,7 @@
 #include "../h/vmSupport.h"
 #include "../h/delayDaemon.h"
 #include "../h/deviceSupportDMA.h"
+#include "../h/klib.h"
 
 /*
  * This function is called when a general exception occurs in a user process.
@@ -119,6 +122,28 @@ void supportSyscallHandler(state_t *exceptionState)
     case DELAY:
         supDelay(exceptionState->s_a1);
         break;
+    case SETSHARE:
+        /* Set the CPU share of the calling process */
+        supSetShare(exceptionState);
+        break;
+    case SETPERIODIC:
+        /* Register the calling process as a periodic real-time task */
+        exceptionState->s_v0 = SYSCALL(SETREALTIME, exceptionState->s_a1, exceptionState->s_a2, 0);
+        LDST(exceptionState);
+        break;
+    case WAITPERIOD:
+        /* Wait for the next period of a periodic real-time task */
+        exceptionState->s_v0 = SYSCALL(WAITRELEASE, 0, 0, 0);
+        LDST(exceptionState);
+        break;
+    case GETLATENCY:
+        /* Copy the run-queue latency histograms to the U-proc */
+        supGetLatency(exceptionState);
+        break;
+    case GETCPUTIMES:
+        /* Copy the CPU time breakdown to the U-proc */
+        supGetCPUTimes(exceptionState);
+        break;
     default:
         /* Invalid syscall, terminate the process */
         supTerminate();
@@ -133,17 +158,19 @@ void supportSyscallHandler(state_t *exceptionState)
  */
 void supTerminate()
 {
+    support_t *support = (support_t *)SYSCALL(GETSUPPORTPTR, 0, 0, 0); /* Get support struct */
+
     /* Free all swap pool entries belonging to this process */
     int i;
     for (i = 0; i < SWAP_POOL_SIZE; i++)
     {
-        if (swapPool[i].occupied && swapPool[i].asid == currentProcess->p_supportStruct->sup_asid)
+        if (swapPool[i].occupied && swapPool[i].asid == support->sup_asid)
         {
             freeFrame(i);
         }
     }
-    SYSCALL(VERHOGEN, (int)&masterSemaphore, 0, 0);     /* SYS4: V(masterSemaphore) */
-    freeSupportStruct(currentProcess->p_supportStruct); /* Free the support structure */
+    SYSCALL(VERHOGEN, (int)&masterSemaphore, 0, 0); /* SYS4: V(masterSemaphore) */
+    freeSupportStruct(support);                     /* Free the support structure */
     SYSCALL(TERMINATEPROCESS, 0, 0, 0);
 }
 
@@ -162,6 +189,69 @@ void supGetTOD(state_t *exceptionState)
     LDST(exceptionState);
 }
 
+/*
+ * Sets the CPU share of the calling U-proc to the ticket count in a1.
+ * The count must be between 1 and MAXSHARE, otherwise the process is
+ * terminated. The previous share is returned in v0.
+ */
+void supSetShare(state_t *exceptionState)
+{
+    int tickets = exceptionState->s_a1;
+
+    if (tickets <= 0 || tickets > MAXSHARE)
+    {
+        supTerminate();
+    }
+
+    exceptionState->s_v0 = SYSCALL(SETPROCSHARE, tickets, 0, 0);
+
+    LDST(exceptionState);
+}
+
+/*
+ * Copies the run-queue latency histograms, ASL descriptor usage and
+ * mutex hold times (a latstats_t) to the user buffer whose address is in a1. The nucleus
+ * fills a local copy first, so it never touches a page that may be
+ * swapped out. An address outside kuseg terminates the process.
+ */
+void supGetLatency(state_t *exceptionState)
+{
+    latstats_t *userStats = (latstats_t *)exceptionState->s_a1;
+    latstats_t stats;
+
+    if ((memaddr)userStats < KUSEG || !ALIGNED(userStats))
+    {
+        supTerminate();
+    }
+
+    SYSCALL(GETSCHEDSTATS, (int)&stats, 0, 0);
+    memcopy(userStats, &stats, sizeof(latstats_t));
+
+    LDST(exceptionState);
+}
+
+/*
+ * Copies the CPU time breakdown of the U-proc (a cpustats_t: user,
+ * kernel and blocked time, then the interrupt time of all CPUs, in
+ * microseconds) to the user buffer whose address is in a1. Time spent in the support level counts as user
+ * time. An address outside kuseg terminates the process.
+ */
+void supGetCPUTimes(state_t *exceptionState)
+{
+    cpustats_t *userStats = (cpustats_t *)exceptionState->s_a1;
+    cpustats_t stats;
+
+    if ((memaddr)userStats < KUSEG || !ALIGNED(userStats))
+    {
+        supTerminate();
+    }
+
+    SYSCALL(GETCPUSTATS, (int)&stats, 0, 0);
+    memcopy(userStats, &stats, sizeof(cpustats_t));
+
+    LDST(exceptionState);
+}
+
 /*
  * Writes a string from user memory to the assigned printer device.
  * The string address is in a1 and its length in a2. The function validates
@@ -190,18 +280,15 @@ void supWriteToPrinter()
 
     /* Copy string into local buffer */
     char buffer[129]; /* +1 for null terminator */
-    int i;
-    for (i = 0; i < len; i++)
-    {
-        buffer[i] = virtAddr[i]; /* Copy string from user memory */
-    }
+    memcopy(buffer, virtAddr, len); /* Copy string from user memory */
     buffer[len] = '\0';
 
     int charsPrinted = 0;
     int status;
+    int i;
 
     /* Mutual exclusion */
-    SYSCALL(PASSEREN, (int)&printerSem[lineNum], 0, 0);
+    SYSCALL(MUTEXP, (int)&printerSem[lineNum], 0, 0);
 
     for (i = 0; i < len; i++)
     {
@@ -217,14 +304,14 @@ void supWriteToPrinter()
         if ((status & STATUS_MASK) != 1)
         {
             state->s_v0 = -status;                              /* Return error code */
-            SYSCALL(VERHOGEN, (int)&printerSem[lineNum], 0, 0); /* Unlock device */
+            SYSCALL(MUTEXV, (int)&printerSem[lineNum], 0, 0); /* Unlock device */
             LDST(state);                                        /* Return to user */
         }
 
         charsPrinted++;
     }
 
-    SYSCALL(VERHOGEN, (int)&printerSem[lineNum], 0, 0); /* Unlock printer */
+    SYSCALL(MUTEXV, (int)&printerSem[lineNum], 0, 0); /* Unlock printer */
     state->s_v0 = charsPrinted;                         /* Return chars printed */
     LDST(state);                                        /* Resume process */
 }
@@ -256,17 +343,14 @@ void supWriteToTerminal()
     device_t *terminal = DEV_REG_ADDR(TERMINT, lineNum); /* Get terminal device register */
 
     char buffer[129];
-    int i;
-    for (i = 0; i < len; i++)
-    {
-        buffer[i] = virtAddr[i]; /* Copy string from user memory */
-    }
+    memcopy(buffer, virtAddr, len); /* Copy string from user memory */
     buffer[len] = '\0';
 
-    SYSCALL(PASSEREN, (int)&termWriteSem[lineNum], 0, 0);
+    SYSCALL(MUTEXP, (int)&termWriteSem[lineNum], 0, 0);
 
     int status;
     int sent = 0; /* Count of successfully sent characters */
+    int i;
     for (i = 0; i < len; i++)
     {
         terminal->t_transm_command = (buffer[i] << COMMAND_SHIFT) | TRANSMITCHAR; /* Load char and command into transmit register */
@@ -279,14 +363,14 @@ void supWriteToTerminal()
         if ((status & STATUS_MASK) != 5)
         {
             state->s_v0 = -status;                                /* Return negative status */
-            SYSCALL(VERHOGEN, (int)&termWriteSem[lineNum], 0, 0); /* Release semaphore */
+            SYSCALL(MUTEXV, (int)&termWriteSem[lineNum], 0, 0); /* Release semaphore */
             LDST(state);                                          /* Resume process with error result */
         }
 
         sent++;
     }
 
-    SYSCALL(VERHOGEN, (int)&termWriteSem[lineNum], 0, 0); /* Release terminal semaphore */
+    SYSCALL(MUTEXV, (int)&termWriteSem[lineNum], 0, 0); /* Release terminal semaphore */
     state->s_v0 = sent;                                   /* Return number of characters sent */
     LDST(state);                                          /* Resume execution */
 }
@@ -320,7 +404,7 @@ void supReadTerminal()
     char ch;
     int status;
 
-    SYSCALL(PASSEREN, (int)&termReadSem[lineNum], 0, 0); /* Lock terminal for reading */
+    SYSCALL(MUTEXP, (int)&termReadSem[lineNum], 0, 0); /* Lock terminal for reading */
 
     do
     {
@@ -334,7 +418,7 @@ void supReadTerminal()
         if ((status & STATUS_MASK) != 5)
         {
             state->s_v0 = -status;                               /* Negative device status */
-            SYSCALL(VERHOGEN, (int)&termReadSem[lineNum], 0, 0); /* Unlock terminal */
+            SYSCALL(MUTEXV, (int)&termReadSem[lineNum], 0, 0); /* Unlock terminal */
             LDST(state);                                         /* Resume with error */
         }
 
@@ -345,13 +429,9 @@ void supReadTerminal()
 
     buffer[count] = '\0'; /* Null-terminate just in case */
 
-    int i;
-    for (i = 0; i < count; i++)
-    {
-        virtAddr[i] = buffer[i]; /* Copy to user space */
-    }
+    memcopy(virtAddr, buffer, count); /* Copy to user space */
 
-    SYSCALL(VERHOGEN, (int)&termReadSem[lineNum], 0, 0); /* Release read semaphore */
+    SYSCALL(MUTEXV, (int)&termReadSem[lineNum], 0, 0); /* Release read semaphore */
     state->s_v0 = count;                                 /* Return number of characters read */
     LDST(state);
 }
@@ -359,12 +439,13 @@ void supReadTerminal()
 /*
  * This function handles program trap exceptions raised by a user process,
  * such as illegal memory access or arithmetic errors. It ensures that any
- * held swap pool semaphore is released before terminating the process. This
+ * held swap pool mutex is released before terminating the process. This
  * prevents deadlocks in cases where the exception occurred while holding
- * shared resources.
+ * shared resources. MUTEXV leaves the mutex alone if this process does
+ * not hold it.
  */
 void supportProgTrapHandler()
 {
-    SYSCALL(VERHOGEN, (int)&swapPoolSem, 0, 0); /* release mutual exclusion if held */
+    SYSCALL(MUTEXV, (int)&swapPoolSem, 0, 0); /* release mutual exclusion if held */
     supTerminate();                             /* orderly termination */
 }
\ No newline at end of file
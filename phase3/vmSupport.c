@@ -24,6 +24,7 @@
 #include "../h/exceptions.h"
 #include "../h/initProc.h"
 #include "../h/sysSupport.h"
+#include "../h/smp.h"
 
 swapPoolEntry_t swapPool[SWAP_POOL_SIZE]; /* Swap Pool: Allocated in kernel memory (after user .text/.data) */
 int swapPoolSem = 1;                      /* Semaphore for mutual exclusion on the swap pool */
@@ -103,7 +104,7 @@ void freeFrame(int frameIndex)
  */
 void pagerHandler()
 {
-    support_t *supportStruct = currentProcess->p_supportStruct; /* Get the support structure of the faulting process */
+    support_t *supportStruct = (support_t *)SYSCALL(GETSUPPORTPTR, 0, 0, 0); /* Get the support structure of the faulting process */
     int asid = supportStruct->sup_asid;                         /* Get the ASID of the current process */
 
     /* Step 1: Get exception state */
@@ -114,11 +115,11 @@ void pagerHandler()
     if (cause == EXC_MOD)
     {
         /* TLB Modification exceptions should not occur */
-        SYSCALL(TERMINATEPROCESS, (int)currentProcess, 0, 0);
+        SYSCALL(TERMINATEPROCESS, 0, 0, 0);
     }
 
     /* Step 4: Gain mutual exclusion over swap pool */
-    SYSCALL(PASSEREN, (int)&swapPoolSem, 0, 0);
+    SYSCALL(MUTEXP, (int)&swapPoolSem, 0, 0);
 
     /* Step 5: Determine missing VPN */
     unsigned int entryHi = exceptionState->s_entryHI;
@@ -177,6 +178,9 @@ void pagerHandler()
         }
         setSTATUS(getSTATUS() | IECON); /* Re-enable interrupts */
 
+        /* Wait until no other CPU can still reach the frame through its TLB */
+        tlbShootdown();
+
         /* Save evicted page to flash */
         writePageToBackingStore(victimASID, victimVPN, frameIndex);
     }
@@ -200,7 +204,7 @@ void pagerHandler()
     setSTATUS(getSTATUS() | IECON); /* Re-enable interrupts */
 
     /* Step 13: Release semaphore */
-    SYSCALL(VERHOGEN, (int)&swapPoolSem, 0, 0);
+    SYSCALL(MUTEXV, (int)&swapPoolSem, 0, 0);
 
     /* Step 14: Return to process */
     LDST(exceptionState);
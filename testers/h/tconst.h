@@ -31,6 +31,15 @@
 #define DELAY			18
 #define PSEMVIRT		19
 #define VSEMVIRT		20
+#define SETSHARE		21
+#define SETPERIODIC		22
+#define WAITPERIOD		23
+#define GETLATENCY		24
+#define GETCPUTIMES		25
+
+#define LATBUCKETS		20	/* Buckets of each GETLATENCY histogram */
+#define LATWORDS		(2 * LATBUCKETS + 5)	/* Words returned by GETLATENCY: both histograms, ASL descriptors in use and peak, mutex acquires, total and longest hold */
+#define CPUTIMES		4	/* Words returned by GETCPUTIMES: user, kernel, blocked time, interrupt time of all CPUs */
 
 #define SEG0			0x00000000
 #define SEG1			0x40000000